@@ -17,7 +17,10 @@ namespace ccode
 
 // this function generates a crosshair code encoding user changable settings, in the format:
 // enabled;r;g;b;length;gap;thickness;dotenabled;dotsize;shadowenabled;shadowblur;shadowalpha
-QString generateCode(Config &m_opt)
+// followed by ;outlineenabled;outlinethickness;or;og;ob only if the outline is enabled,
+// and a |r;g;b;length;gap;thickness;dotenabled;dotsize group per extra layer.
+// codes without an outline or extra layers stay readable by older versions
+QString generateCode(const Config &m_opt)
 {
     QString code;
 
@@ -34,19 +37,42 @@ QString generateCode(Config &m_opt)
     code += QString("%1;").arg(m_opt.shadowBlurRadius);
     code += QString("%1").arg(m_opt.shadowColor.alpha());
 
+    if (m_opt.outline)
+    {
+        code += QString(";%1").arg(1);
+        code += QString(";%1").arg(m_opt.outlineThickness);
+        code += QString(";%1").arg(m_opt.outlineColor.red());
+        code += QString(";%1").arg(m_opt.outlineColor.green());
+        code += QString(";%1").arg(m_opt.outlineColor.blue());
+    }
+
+    for (const Config::Layer &layer : m_opt.extraLayers)
+    {
+        code += QString("|%1;%2;%3").arg(layer.color.red()).arg(layer.color.green()).arg(layer.color.blue());
+        code += QString(";%1;%2;%3").arg(layer.length).arg(layer.gap).arg(layer.thickness);
+        code += QString(";%1;%2").arg(layer.dot ? 1 : 0).arg(layer.dotSize);
+    }
+
     return code;
 }
 
 // takes a crosshair code, if it has the right amount of
-// values its parsed and passed into the settings
-void applyCode(QString &code, Config &m_opt)
+// values its parsed and passed into the settings.
+// returns false if the code was rejected
+bool applyCode(const QString &code, Config &m_opt)
 {
     Config defaultOptions;
-    QStringList parts = code.split(';');
+    QStringList groups = code.split('|');
+    QStringList parts = groups.takeFirst().split(';');
+
+    if (parts.size() != 12 && parts.size() != 17)
+    {
+        return false;
+    }
 
-    if (parts.size() != 12)
+    if (groups.size() > Config::maxExtraLayers)
     {
-        return;
+        return false;
     }
 
     // helper to convert QString into int
@@ -56,6 +82,27 @@ void applyCode(QString &code, Config &m_opt)
         return ok ? val : fallback;
     };
 
+    // extra layers, checked before anything is applied
+    QList<Config::Layer> layers;
+    for (const QString &group : groups)
+    {
+        QStringList values = group.split(';');
+        if (values.size() != 8)
+        {
+            return false;
+        }
+
+        Config::Layer layer;
+        layer.color = QColor(toInt(values[0], layer.color.red()), toInt(values[1], layer.color.green()),
+                             toInt(values[2], layer.color.blue()));
+        layer.length = toInt(values[3], layer.length);
+        layer.gap = toInt(values[4], layer.gap);
+        layer.thickness = toInt(values[5], layer.thickness);
+        layer.dot = toInt(values[6], layer.dot ? 1 : 0) != 0;
+        layer.dotSize = toInt(values[7], layer.dotSize);
+        layers.append(layer);
+    }
+
     // crosshair enable/disable
     m_opt.enabled = toInt(parts[0], defaultOptions.enabled ? 1 : 0) != 0;
 
@@ -79,6 +126,22 @@ void applyCode(QString &code, Config &m_opt)
     m_opt.shadowBlurRadius = toInt(parts[10], defaultOptions.shadowBlurRadius);
     int a = toInt(parts[11], defaultOptions.shadowColor.alpha());
     m_opt.shadowColor.setAlpha(a);
+
+    // outline, codes without it have the outline disabled
+    m_opt.outline = false;
+    if (parts.size() == 17)
+    {
+        m_opt.outline = toInt(parts[12], 0) != 0;
+        m_opt.outlineThickness = toInt(parts[13], defaultOptions.outlineThickness);
+        r = toInt(parts[14], defaultOptions.outlineColor.red());
+        g = toInt(parts[15], defaultOptions.outlineColor.green());
+        b = toInt(parts[16], defaultOptions.outlineColor.blue());
+        m_opt.outlineColor = QColor(r, g, b);
+    }
+
+    m_opt.extraLayers = layers;
+
+    return true;
 }
 
 } // namespace ccode
\ No newline at end of file
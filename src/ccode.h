@@ -14,8 +14,8 @@
 namespace ccode
 {
 
-QString generateCode(Config &m_opt);
+QString generateCode(const Config &m_opt);
 
-void applyCode(QString &code, Config &m_opt);
+bool applyCode(const QString &code, Config &m_opt);
 
 } // namespace ccode
\ No newline at end of file
@@ -9,7 +9,42 @@
 #include "config.h"
 
 #include "ui_preset.h"
+#include <QList>
 #include <QSettings>
+#include <QSignalBlocker>
+#include <vector>
+
+bool Config::Layer::operator==(const Layer &other) const
+{
+    return color == other.color && length == other.length && gap == other.gap && thickness == other.thickness &&
+           dot == other.dot && dotSize == other.dotSize;
+}
+
+// the arm options of a layer, 0 is the main crosshair
+// and 1 and up are the extra layers on top of it
+Config::Layer Config::layer(int index) const
+{
+    if (index > 0)
+        return extraLayers.at(index - 1);
+
+    return {color, length, gap, thickness, dot, dotSize};
+}
+
+void Config::setLayer(int index, const Layer &layer)
+{
+    if (index > 0)
+    {
+        extraLayers[index - 1] = layer;
+        return;
+    }
+
+    color = layer.color;
+    length = layer.length;
+    gap = layer.gap;
+    thickness = layer.thickness;
+    dot = layer.dot;
+    dotSize = layer.dotSize;
+}
 
 // restores the default config in memory.
 // DOES NOT write the changes to disk on its own
@@ -27,6 +62,13 @@ void Config::resetConfig()
     shadow = defaultOptions.shadow;
     shadowBlurRadius = defaultOptions.shadowBlurRadius;
     shadowColor = defaultOptions.shadowColor;
+    outline = defaultOptions.outline;
+    outlineThickness = defaultOptions.outlineThickness;
+    outlineColor = defaultOptions.outlineColor;
+    adaptive = defaultOptions.adaptive;
+    adaptiveColor = defaultOptions.adaptiveColor;
+    adaptiveRate = defaultOptions.adaptiveRate;
+    extraLayers = defaultOptions.extraLayers;
     currentScreenIndex = defaultOptions.currentScreenIndex;
 }
 
@@ -36,46 +78,118 @@ void Config::loadConfig()
 {
     QSettings settings("Crosshair++", "config");
 
-    Config defaultOptions;
+    loadFrom(settings);
+}
+
+// reads all options from the given settings. options that
+// are missing in there keep their current value
+void Config::loadFrom(QSettings &settings)
+{
+    firstTime = settings.value("crosshair/firstTime", firstTime).toBool();
+    enabled = settings.value("crosshair/enabled", enabled).toBool();
+    color = settings.value("crosshair/color", color).value<QColor>();
+    length = settings.value("crosshair/length", length).toInt();
+    thickness = settings.value("crosshair/thickness", thickness).toInt();
+    gap = settings.value("crosshair/gap", gap).toInt();
+    dot = settings.value("crosshair/dotEnabled", dot).toBool();
+    dotSize = settings.value("crosshair/dotSize", dotSize).toInt();
+    shadow = settings.value("crosshair/shadowEnabled", shadow).toBool();
+    shadowBlurRadius = settings.value("crosshair/shadowRadius", shadowBlurRadius).toInt();
+    outline = settings.value("crosshair/outlineEnabled", outline).toBool();
+    outlineThickness = settings.value("crosshair/outlineThickness", outlineThickness).toInt();
+    outlineColor = settings.value("crosshair/outlineColor", outlineColor).value<QColor>();
+    adaptive = settings.value("crosshair/adaptive", adaptive).toBool();
+    adaptiveColor = settings.value("crosshair/adaptiveColor", adaptiveColor).value<QColor>();
+    adaptiveRate = settings.value("crosshair/adaptiveRate", adaptiveRate).toInt();
+    currentScreenIndex = settings.value("crosshair/currentScreenIndex", currentScreenIndex).toInt();
 
-    firstTime = settings.value("crosshair/firstTime", defaultOptions.firstTime).toBool();
-    enabled = settings.value("crosshair/enabled", defaultOptions.enabled).toBool();
-    color = settings.value("crosshair/color", defaultOptions.color).value<QColor>();
-    length = settings.value("crosshair/length", defaultOptions.length).toInt();
-    thickness = settings.value("crosshair/thickness", defaultOptions.thickness).toInt();
-    gap = settings.value("crosshair/gap", defaultOptions.gap).toInt();
-    dot = settings.value("crosshair/dotEnabled", defaultOptions.dot).toBool();
-    dotSize = settings.value("crosshair/dotSize", defaultOptions.dotSize).toInt();
-    shadow = settings.value("crosshair/shadowEnabled", defaultOptions.shadow).toBool();
-    shadowBlurRadius = settings.value("crosshair/shadowRadius", defaultOptions.shadowBlurRadius).toInt();
-    currentScreenIndex = settings.value("crosshair/currentScreenIndex", defaultOptions.currentScreenIndex).toBool();
-
-    int alpha = settings.value("crosshair/shadowAlpha", defaultOptions.shadowColor.alpha()).toInt();
+    int alpha = settings.value("crosshair/shadowAlpha", shadowColor.alpha()).toInt();
     shadowColor = QColor(0, 0, 0, alpha);
+
+    // extra layers, only if the settings have the list at all
+    if (settings.contains("crosshair/layers/size"))
+    {
+        const int count = settings.beginReadArray("crosshair/layers");
+        extraLayers.clear();
+
+        for (int i = 0; i < count; ++i)
+        {
+            settings.setArrayIndex(i);
+
+            Layer layer;
+            layer.color = settings.value("color", layer.color).value<QColor>();
+            layer.length = settings.value("length", layer.length).toInt();
+            layer.gap = settings.value("gap", layer.gap).toInt();
+            layer.thickness = settings.value("thickness", layer.thickness).toInt();
+            layer.dot = settings.value("dotEnabled", layer.dot).toBool();
+            layer.dotSize = settings.value("dotSize", layer.dotSize).toInt();
+            extraLayers.append(layer);
+        }
+
+        settings.endArray();
+    }
 }
 
-// updates all the setting widgets to match the config in memory
-void Config::showConfig(Ui::MainWindow &ui)
+// updates all the setting widgets to match the config in memory, the
+// crosshair widgets show the given layer. the widgets signals are blocked
+// meanwhile, so this doesn't feed back into the change handlers of the MainWindow
+void Config::showConfig(Ui::MainWindow &ui, int layer)
 {
+    const QList<QWidget *> widgets = {ui.i_enableCrosshair, ui.i_length,        ui.i_length_2,
+                                      ui.i_thickness,       ui.i_thickness_2,   ui.i_gap,
+                                      ui.i_gap_2,           ui.i_dotEnabled,    ui.i_dotSize,
+                                      ui.i_dotSize_2,       ui.i_shadow,        ui.i_shadowradius,
+                                      ui.i_shadowradius_2,  ui.i_shadowalpha,   ui.i_shadowalpha_2,
+                                      ui.i_outline,         ui.i_outlinewidth,  ui.i_outlinewidth_2,
+                                      ui.i_adaptive,        ui.i_layer};
+
+    std::vector<QSignalBlocker> blockers;
+    blockers.reserve(widgets.size());
+    for (QWidget *widget : widgets)
+        blockers.emplace_back(widget);
+
     ui.i_enableCrosshair->setChecked(enabled);
 
-    ui.i_length->setValue(length);
-    ui.i_thickness->setValue(thickness);
-    ui.i_gap->setValue(gap);
-    ui.i_dotEnabled->setChecked(dot);
-    ui.i_dotSize->setValue(dotSize);
+    // layer selection. the entries only depend on the number of layers,
+    // so they are only added or removed when a layer was, not on every
+    // slider tick
+    layer = std::clamp(layer, 0, int(extraLayers.size()));
+    if (ui.i_layer->count() == 0)
+        ui.i_layer->addItem("Main");
+    while (ui.i_layer->count() > extraLayers.size() + 1)
+        ui.i_layer->removeItem(ui.i_layer->count() - 1);
+    while (ui.i_layer->count() < extraLayers.size() + 1)
+        ui.i_layer->addItem(QString("Layer %1").arg(ui.i_layer->count() + 1));
+    if (ui.i_layer->currentIndex() != layer)
+        ui.i_layer->setCurrentIndex(layer);
+    ui.i_addLayer->setEnabled(extraLayers.size() < maxExtraLayers);
+    ui.i_removeLayer->setEnabled(layer > 0);
+
+    const Layer shown = this->layer(layer);
+
+    ui.i_length->setValue(shown.length);
+    ui.i_thickness->setValue(shown.thickness);
+    ui.i_gap->setValue(shown.gap);
+    ui.i_dotEnabled->setChecked(shown.dot);
+    ui.i_dotSize->setValue(shown.dotSize);
     ui.i_shadow->setChecked(shadow);
     ui.i_shadowradius->setValue(shadowBlurRadius);
     ui.i_shadowalpha->setValue(shadowColor.alpha());
 
-    ui.i_length_2->setValue(length);
-    ui.i_thickness_2->setValue(thickness);
-    ui.i_gap_2->setValue(gap);
-    ui.i_dotEnabled->setChecked(dot);
-    ui.i_dotSize_2->setValue(dotSize);
+    ui.i_length_2->setValue(shown.length);
+    ui.i_thickness_2->setValue(shown.thickness);
+    ui.i_gap_2->setValue(shown.gap);
+    ui.i_dotEnabled->setChecked(shown.dot);
+    ui.i_dotSize_2->setValue(shown.dotSize);
     ui.i_shadow->setChecked(shadow);
     ui.i_shadowradius_2->setValue(shadowBlurRadius);
     ui.i_shadowalpha_2->setValue(shadowColor.alpha());
+
+    ui.i_outline->setChecked(outline);
+    ui.i_outlinewidth->setValue(outlineThickness);
+    ui.i_outlinewidth_2->setValue(outlineThickness);
+
+    ui.i_adaptive->setChecked(adaptive);
 }
 
 // save current config to disk / Win Registry
@@ -84,6 +198,12 @@ void Config::saveConfig()
 {
     QSettings settings("Crosshair++", "config");
 
+    saveTo(settings);
+}
+
+// writes all options into the given settings
+void Config::saveTo(QSettings &settings)
+{
     clamp();
 
     settings.setValue("crosshair/firstTime", firstTime);
@@ -98,6 +218,26 @@ void Config::saveConfig()
     settings.setValue("crosshair/shadowEnabled", shadow);
     settings.setValue("crosshair/shadowRadius", shadowBlurRadius);
     settings.setValue("crosshair/shadowAlpha", shadowColor.alpha());
+    settings.setValue("crosshair/outlineEnabled", outline);
+    settings.setValue("crosshair/outlineThickness", outlineThickness);
+    settings.setValue("crosshair/outlineColor", outlineColor);
+    settings.setValue("crosshair/adaptive", adaptive);
+    settings.setValue("crosshair/adaptiveColor", adaptiveColor);
+    settings.setValue("crosshair/adaptiveRate", adaptiveRate);
+
+    settings.beginWriteArray("crosshair/layers", extraLayers.size());
+    for (int i = 0; i < extraLayers.size(); ++i)
+    {
+        const Layer &layer = extraLayers.at(i);
+        settings.setArrayIndex(i);
+        settings.setValue("color", layer.color);
+        settings.setValue("length", layer.length);
+        settings.setValue("gap", layer.gap);
+        settings.setValue("thickness", layer.thickness);
+        settings.setValue("dotEnabled", layer.dot);
+        settings.setValue("dotSize", layer.dotSize);
+    }
+    settings.endArray();
 
     settings.setValue("crosshair/currentScreenIndex", currentScreenIndex);
 }
@@ -110,4 +250,40 @@ void Config::clamp()
     dotSize = std::clamp(dotSize, 0, 100);
     shadowBlurRadius = std::clamp(shadowBlurRadius, 0, 24);
     shadowColor.setAlpha(std::clamp(shadowColor.alpha(), 0, 255));
-}
\ No newline at end of file
+    outlineThickness = std::clamp(outlineThickness, 1, 5);
+    adaptiveRate = std::clamp(adaptiveRate, 1, 30);
+
+    // the upper bound depends on the screens that are connected, users
+    // of the index check it against QGuiApplication::screens()
+    currentScreenIndex = qMax(0, currentScreenIndex);
+
+    if (extraLayers.size() > maxExtraLayers)
+        extraLayers.resize(maxExtraLayers);
+
+    // only written back if something was out of range, so a
+    // list shared with a copy of this config isn't detached
+    for (int i = 0; i < extraLayers.size(); ++i)
+    {
+        Layer layer = extraLayers.at(i);
+        layer.length = std::clamp(layer.length, 1, 50);
+        layer.gap = std::clamp(layer.gap, 0, 50);
+        layer.thickness = std::clamp(layer.thickness, 1, 50);
+        layer.dotSize = std::clamp(layer.dotSize, 0, 100);
+
+        if (!(layer == extraLayers.at(i)))
+            extraLayers[i] = layer;
+    }
+}
+
+// true if every option is the same
+bool Config::operator==(const Config &other) const
+{
+    return enabled == other.enabled && firstTime == other.firstTime && color == other.color &&
+           length == other.length && gap == other.gap && thickness == other.thickness && dot == other.dot &&
+           dotSize == other.dotSize && shadow == other.shadow && shadowBlurRadius == other.shadowBlurRadius &&
+           shadowColor == other.shadowColor && outline == other.outline &&
+           outlineThickness == other.outlineThickness && outlineColor == other.outlineColor &&
+           adaptive == other.adaptive && adaptiveColor == other.adaptiveColor && adaptiveRate == other.adaptiveRate &&
+           extraLayers == other.extraLayers && currentScreenIndex == other.currentScreenIndex &&
+           devicePixelRatio == other.devicePixelRatio && supersample == other.supersample;
+}
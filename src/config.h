@@ -10,10 +10,28 @@
 
 #include "ui_preset.h"
 #include <QColor>
+#include <QList>
+#include <QSettings>
 
 class Config
 {
   public:
+    // the arms and center dot of one crosshair
+    struct Layer
+    {
+        QColor color = QColor(255, 255, 255);
+        int length = 8;
+        int gap = 32;
+        int thickness = 2;
+        bool dot = true;
+        int dotSize = 4;
+
+        bool operator==(const Layer &other) const;
+    };
+
+    // how many layers can be stacked on top of the main crosshair
+    static constexpr int maxExtraLayers = 4;
+
     bool enabled = true;
     bool firstTime = true;
     QColor color = QColor(255, 255, 255);
@@ -25,17 +43,34 @@ class Config
     bool shadow = true;
     int shadowBlurRadius = 3;
     QColor shadowColor = QColor(0, 0, 0, 255);
+    bool outline = false;
+    int outlineThickness = 1;
+    QColor outlineColor = QColor(0, 0, 0);
+    bool adaptive = false;
+    QColor adaptiveColor = QColor(0, 0, 0);
+    int adaptiveRate = 4;
+    QList<Layer> extraLayers;
     int currentScreenIndex = 0;
     qreal devicePixelRatio = 1.0;
     qreal supersample = 1.0;
 
+    Layer layer(int index) const;
+
+    void setLayer(int index, const Layer &layer);
+
     void resetConfig();
 
     void loadConfig();
 
-    void showConfig(Ui::MainWindow &ui);
+    void loadFrom(QSettings &settings);
+
+    void showConfig(Ui::MainWindow &ui, int layer = 0);
 
     void saveConfig();
 
+    void saveTo(QSettings &settings);
+
     void clamp();
+
+    bool operator==(const Config &other) const;
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "contrast.h"
+
+#include "pixel.h"
+#include <QGuiApplication>
+#include <QList>
+#include <QPixmap>
+#include <QScreen>
+#include <algorithm>
+
+// luma difference the other color has to win by before switching,
+// so backgrounds in between don't make the crosshair flicker
+static constexpr int hysteresis = 24;
+
+// sampling may use at most this share of one core. if it gets more
+// expensive (e.g. slow screen grabs) the rate is halved
+static constexpr double maxLoad = 0.01;
+
+// how often the load is checked, in milliseconds
+static constexpr int loadWindow = 2000;
+
+// longest interval the rate gets lowered to, in milliseconds
+static constexpr int maxInterval = 1000;
+
+// upper bound for the width and height of the sampled region
+static constexpr int maxSampleSize = 128;
+
+static int luma(const QColor &color)
+{
+    return pixel::luma(color.red(), color.green(), color.blue());
+}
+
+ContrastSampler::ContrastSampler(Config &cfg, const Crosshair::Layers &layers, QObject *parent)
+    : QObject(parent), m_config(cfg), m_layers(layers)
+{
+    connect(&m_timer, &QTimer::timeout, this, &ContrastSampler::sample);
+}
+
+// starts or stops sampling to match the config. it only runs while the
+// adaptive mode is on and the crosshair is shown, otherwise it costs
+// nothing, not even a timer wakeup
+void ContrastSampler::update()
+{
+    if (!m_config.adaptive || !m_config.enabled)
+    {
+        m_timer.stop();
+        m_active = 0;
+        return;
+    }
+
+    if (m_timer.isActive() && m_rate == m_config.adaptiveRate)
+        return;
+
+    m_rate = m_config.adaptiveRate;
+    m_interval = 1000 / m_rate;
+    m_timer.start(m_interval);
+
+    m_window.start();
+    m_busy = 0;
+}
+
+// the color the crosshair should currently be drawn with
+QColor ContrastSampler::activeColor() const
+{
+    return m_active == 0 ? m_config.color : m_config.adaptiveColor;
+}
+
+// region around the crosshair center that is sampled
+QSize ContrastSampler::sampleSize() const
+{
+    const int size = qMin(maxSampleSize, (m_config.length + m_config.gap) * 2 + 8);
+    return QSize(size, size);
+}
+
+// takes a background the size of sampleSize(), centered on the crosshair,
+// and switches colors if the other one contrasts more by at least the
+// hysteresis. pixels covered by the crosshair itself are ignored, since
+// screen grabs include the overlay. returns true if the color changed
+bool ContrastSampler::feed(const QImage &background)
+{
+    const QImage &overlay = m_layers.composite;
+    const QPoint offset(overlay.width() / 2 - background.width() / 2, overlay.height() / 2 - background.height() / 2);
+
+    const int lum = pixel::luminance(background, overlay.isNull() ? nullptr : &overlay, offset);
+    if (lum < 0)
+        return false;
+
+    m_lastLuminance = lum;
+
+    const int contrast[2] = {qAbs(lum - luma(m_config.color)), qAbs(lum - luma(m_config.adaptiveColor))};
+    if (contrast[1 - m_active] <= contrast[m_active] + hysteresis)
+        return false;
+
+    m_active = 1 - m_active;
+    emit switched();
+
+    return true;
+}
+
+// grabs the region around the crosshair and feeds it into the decision.
+// keeps track of the time spent and lowers the rate if it gets too high
+void ContrastSampler::sample()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // without any screen there is nothing to sample, update()
+    // starts sampling again with the next render
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    if (screens.isEmpty())
+    {
+        m_timer.stop();
+        return;
+    }
+
+    // the overlay clamps the screen index the same way
+    QScreen *screen = screens[std::clamp(m_config.currentScreenIndex, 0, int(screens.size()) - 1)];
+
+    // the overlay is centered on the screen, so is the sampled region
+    const QSize size = sampleSize();
+    const QRect geometry = screen->geometry();
+    const int x = geometry.width() / 2 - size.width() / 2;
+    const int y = geometry.height() / 2 - size.height() / 2;
+
+    QImage background = screen->grabWindow(0, x, y, size.width(), size.height()).toImage();
+    if (background.format() != QImage::Format_RGB32 && background.format() != QImage::Format_ARGB32 &&
+        background.format() != QImage::Format_ARGB32_Premultiplied)
+        background.convertTo(QImage::Format_RGB32);
+
+    feed(background);
+
+    const qint64 busy = timer.nsecsElapsed();
+    m_busy += busy;
+    m_totalBusy += busy;
+    ++m_samples;
+
+    if (m_window.elapsed() < loadWindow)
+        return;
+
+    const double load = double(m_busy) / m_window.nsecsElapsed();
+    if (load > maxLoad && m_interval < maxInterval)
+    {
+        m_interval = qMin(maxInterval, m_interval * 2);
+        m_timer.setInterval(m_interval);
+        ++m_slowdowns;
+    }
+
+    m_window.restart();
+    m_busy = 0;
+}
+
+// sampling cost summary
+QString ContrastSampler::report() const
+{
+    if (m_samples == 0)
+        return "adaptive color: no samples";
+
+    const double average = m_totalBusy / 1e6 / m_samples;
+
+    return QString("adaptive color: %1 samples, %2 ms per sample at %3 Hz (%4% of a core, rate lowered %5 times), "
+                   "last luminance %6")
+        .arg(m_samples)
+        .arg(average, 0, 'f', 3)
+        .arg(m_interval > 0 ? 1000.0 / m_interval : 0.0, 0, 'f', 1)
+        .arg(m_interval > 0 ? average / m_interval * 100 : 0.0, 0, 'f', 3)
+        .arg(m_slowdowns)
+        .arg(m_lastLuminance);
+}
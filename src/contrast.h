@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "crosshair.h"
+#include <QColor>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QTimer>
+
+// samples a small region of the screen around the crosshair and picks
+// whichever of the two configured colors contrasts more with it
+class ContrastSampler : public QObject
+{
+    Q_OBJECT
+
+  public:
+    ContrastSampler(Config &cfg, const Crosshair::Layers &layers, QObject *parent = nullptr);
+
+    void update();
+
+    bool feed(const QImage &background);
+
+    QColor activeColor() const;
+
+    QSize sampleSize() const;
+
+    QString report() const;
+
+  signals:
+    // emitted when the other color was picked
+    void switched();
+
+  private:
+    void sample();
+
+    Config &m_config;
+    const Crosshair::Layers &m_layers;
+
+    QTimer m_timer;
+    int m_rate = 0;
+    int m_interval = 0;
+
+    // 0 is the crosshair color, 1 the adaptive color
+    int m_active = 0;
+    int m_lastLuminance = -1;
+
+    // cost accounting, time spent sampling since the rate was last checked
+    QElapsedTimer m_window;
+    qint64 m_busy = 0;
+    qint64 m_samples = 0;
+    qint64 m_totalBusy = 0;
+
+    // how often the sampling was too expensive and its rate was lowered
+    qint64 m_slowdowns = 0;
+};
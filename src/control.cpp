@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "control.h"
+
+#include "config.h"
+#include "crosshair.h"
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QList>
+#include <QScreen>
+#include <QTextStream>
+#include <QtMath>
+#include <chrono>
+#include <new>
+#include <thread>
+
+namespace control
+{
+
+// a reader gives up after this many torn reads in a row and tries again
+// on the next frame, e.g. if a writer died in the middle of a write
+static constexpr int maxAttempts = 64;
+
+static qint64 steadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// creates the control block. this doubles as the probe for other running
+// instances, since only one process can create it. returns false if it
+// already exists
+bool create(QSharedMemory &shared)
+{
+    // on unix the memory of a crashed instance outlives it, attaching
+    // and detaching again frees it as long as nobody else uses it
+    {
+        QSharedMemory stale(key);
+        if (stale.attach())
+            stale.detach();
+    }
+
+    shared.setKey(key);
+    if (!shared.create(sizeof(Block)))
+        return false;
+
+    shared.lock();
+    Block *block = new (shared.data()) Block();
+    block->magic = magic;
+    block->version = version;
+    block->visible.store(1, std::memory_order_relaxed);
+    block->sequence.store(0, std::memory_order_release);
+    shared.unlock();
+
+    return true;
+}
+
+// attaches to the control block of the running app, for writers.
+// returns nullptr if there is none or it has an unknown layout
+Block *attach(QSharedMemory &shared)
+{
+    shared.setKey(key);
+    if (!shared.attach())
+        return nullptr;
+
+    shared.lock();
+    Block *block = static_cast<Block *>(shared.data());
+    const bool valid = shared.size() >= qsizetype(sizeof(Block)) && block->magic == magic && block->version == version;
+    shared.unlock();
+
+    if (!valid)
+    {
+        shared.detach();
+        return nullptr;
+    }
+
+    return block;
+}
+
+// publishes state as one consistent update
+void write(Block *block, const State &state)
+{
+    const quint32 sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    block->fields.store(state.fields, std::memory_order_relaxed);
+    block->visible.store(state.visible ? 1 : 0, std::memory_order_relaxed);
+    block->color.store(state.color & 0xffffff, std::memory_order_relaxed);
+    block->length.store(state.length, std::memory_order_relaxed);
+    block->gap.store(state.gap, std::memory_order_relaxed);
+    block->thickness.store(state.thickness, std::memory_order_relaxed);
+    block->dot.store(state.dot ? 1 : 0, std::memory_order_relaxed);
+    block->dotSize.store(state.dotSize, std::memory_order_relaxed);
+    block->stamp.store(state.stamp, std::memory_order_relaxed);
+
+    block->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// copies the block into state, retrying while a write is in progress.
+// never waits for the writer. returns false if no consistent copy was
+// made, retries counts the torn reads
+bool read(const Block *block, State &state, int *retries)
+{
+    for (int attempt = 0; attempt < maxAttempts; ++attempt)
+    {
+        const quint32 sequence = block->sequence.load(std::memory_order_acquire);
+
+        if (!(sequence & 1))
+        {
+            State copy;
+            copy.sequence = sequence;
+            copy.fields = block->fields.load(std::memory_order_relaxed);
+            copy.visible = block->visible.load(std::memory_order_relaxed) != 0;
+            copy.color = block->color.load(std::memory_order_relaxed);
+            copy.length = block->length.load(std::memory_order_relaxed);
+            copy.gap = block->gap.load(std::memory_order_relaxed);
+            copy.thickness = block->thickness.load(std::memory_order_relaxed);
+            copy.dot = block->dot.load(std::memory_order_relaxed) != 0;
+            copy.dotSize = block->dotSize.load(std::memory_order_relaxed);
+            copy.stamp = block->stamp.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (block->sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                state = copy;
+                return true;
+            }
+        }
+
+        if (retries)
+            ++*retries;
+    }
+
+    return false;
+}
+
+// stand in for an external tool, drives the running app like a telemetry
+// reader would: the gap follows a spread curve while moving and the color
+// flips every second. writes at rate per second (0 for as fast as it can)
+// and prints how many writes it got through and what they cost.
+// returns the process exit code
+int drive(double rate, double seconds)
+{
+    QTextStream out(stdout);
+
+    QSharedMemory shared;
+    Block *block = attach(shared);
+    if (!block)
+    {
+        out << "no running Crosshair++ to drive\n";
+        return 1;
+    }
+
+    State state;
+    state.fields = Visible | Color | Gap;
+    state.visible = true;
+
+    const qint64 interval = rate > 0 ? qint64(1e9 / rate) : 0;
+    const qint64 end = qint64(seconds * 1e9);
+
+    QElapsedTimer clock;
+    clock.start();
+
+    qint64 writes = 0;
+    qint64 busy = 0;
+
+    for (qint64 now = 0; now < end; now = clock.nsecsElapsed())
+    {
+        const double t = now / 1e9;
+        state.gap = qRound(4 + 20 * qAbs(qSin(t * M_PI)));
+        state.color = qint64(t) % 2 ? qRgb(255, 60, 60) : qRgb(60, 255, 60);
+        state.stamp = steadyNow();
+
+        const qint64 before = clock.nsecsElapsed();
+        write(block, state);
+        busy += clock.nsecsElapsed() - before;
+        ++writes;
+
+        if (interval > 0)
+        {
+            const qint64 wait = writes * interval - clock.nsecsElapsed();
+            if (wait > 0)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+        }
+    }
+
+    const double elapsed = qMax(clock.nsecsElapsed() / 1e9, 1e-9);
+    out << QString("%1 writes in %2 s (%3/s), %4 ns per write\n")
+               .arg(writes)
+               .arg(elapsed, 0, 'f', 2)
+               .arg(writes / elapsed, 0, 'f', 0)
+               .arg(writes > 0 ? busy / double(writes) : 0.0, 0, 'f', 0);
+
+    shared.detach();
+    return 0;
+}
+
+} // namespace control
+
+ControlReader::ControlReader(const Config &cfg, const control::Block *block, QObject *parent)
+    : QObject(parent), m_config(cfg), m_block(block)
+{
+    // poll once per frame of the screen the crosshair is on
+    qreal refreshRate = 60;
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    if (m_config.currentScreenIndex >= 0 && m_config.currentScreenIndex < screens.size())
+        refreshRate = screens[m_config.currentScreenIndex]->refreshRate();
+
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(qMax(1, qRound(1000 / qMax(refreshRate, qreal(1)))));
+    connect(&m_timer, &QTimer::timeout, this, &ControlReader::poll);
+    m_timer.start();
+}
+
+void ControlReader::apply(Config &opt) const
+{
+    const control::State &state = m_last;
+
+    if (state.fields & control::Visible)
+        opt.enabled = state.visible;
+    if (state.fields & control::Color)
+        opt.color = QColor::fromRgb(state.color);
+    if (state.fields & control::Length)
+        opt.length = state.length;
+    if (state.fields & control::Gap)
+        opt.gap = state.gap;
+    if (state.fields & control::Thickness)
+        opt.thickness = state.thickness;
+    if (state.fields & control::Dot)
+        opt.dot = state.dot;
+    if (state.fields & control::DotSize)
+        opt.dotSize = state.dotSize;
+
+    opt.clamp();
+}
+
+// reads the block and announces a change if the driven fields look
+// different than before. nothing happens if no write happened since
+// the last poll
+void ControlReader::poll()
+{
+    ++m_polls;
+
+    control::State state;
+    int retries = 0;
+    const bool ok = control::read(m_block, state, &retries);
+    m_retries += retries;
+
+    if (!ok || state.sequence == m_last.sequence)
+        return;
+
+    Config before = m_config;
+    apply(before);
+
+    m_last = state;
+
+    Config after = m_config;
+    apply(after);
+
+    if (state.stamp > 0)
+    {
+        const qint64 latency = control::steadyNow() - state.stamp;
+        m_latencyTotal += latency;
+        m_latencyMax = qMax(m_latencyMax, latency);
+    }
+    ++m_updates;
+
+    if (before.enabled != after.enabled || !Crosshair::sameRender(before, after))
+        emit changed();
+}
+
+// polls, applied writes and the time from a write until it was applied
+QString ControlReader::report() const
+{
+    return QString("control: %1 polls, %2 updates, %3 torn reads, latency mean %4 us max %5 us")
+        .arg(m_polls)
+        .arg(m_updates)
+        .arg(m_retries)
+        .arg(m_updates > 0 ? m_latencyTotal / 1e3 / m_updates : 0.0, 0, 'f', 1)
+        .arg(m_latencyMax / 1e3, 0, 'f', 1);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <QObject>
+#include <QSharedMemory>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+
+namespace control
+{
+
+// name of the shared memory other processes attach to
+inline const QString key = "crosshairpp.control";
+
+static constexpr quint32 magic = 0x43485050; // "CHPP"
+static constexpr quint32 version = 1;
+
+// the options a writer can drive, a writer sets the bits of the ones it
+// wants to control in fields. everything else keeps its configured value
+enum Field : quint32
+{
+    Visible = 1 << 0,
+    Color = 1 << 1,
+    Length = 1 << 2,
+    Gap = 1 << 3,
+    Thickness = 1 << 4,
+    Dot = 1 << 5,
+    DotSize = 1 << 6,
+};
+
+// layout of the shared memory. magic and version are written once by the
+// app before any writer can attach. everything after sequence is guarded
+// by it (a seqlock): it is odd while a write is in progress and every
+// finished write adds 2. there must only be one writer at a time.
+// color is 0xRRGGBB, the booleans are 0 or 1. stamp is the writers
+// std::chrono::steady_clock in ns, so the app can measure how long a
+// write took to show up
+struct Block
+{
+    quint32 magic;
+    quint32 version;
+    std::atomic<quint32> sequence;
+    std::atomic<quint32> fields;
+    std::atomic<quint32> visible;
+    std::atomic<quint32> color;
+    std::atomic<qint32> length;
+    std::atomic<qint32> gap;
+    std::atomic<qint32> thickness;
+    std::atomic<qint32> dot;
+    std::atomic<qint32> dotSize;
+    std::atomic<qint64> stamp;
+};
+
+static_assert(std::atomic<quint32>::is_always_lock_free && std::atomic<qint64>::is_always_lock_free,
+              "the control block needs lock free atomics to be shared between processes");
+
+// a consistent copy of the block
+struct State
+{
+    quint32 sequence = 0;
+    quint32 fields = 0;
+    bool visible = true;
+    QRgb color = 0;
+    int length = 0;
+    int gap = 0;
+    int thickness = 0;
+    bool dot = false;
+    int dotSize = 0;
+    qint64 stamp = 0;
+};
+
+bool create(QSharedMemory &shared);
+
+Block *attach(QSharedMemory &shared);
+
+void write(Block *block, const State &state);
+
+bool read(const Block *block, State &state, int *retries = nullptr);
+
+int drive(double rate, double seconds);
+
+} // namespace control
+
+// reads the control block once per display frame. the driven fields
+// override the config only where it is rendered (like the adaptive color),
+// the config itself and what is saved of it never see them, driving is
+// meant to be temporary
+class ControlReader : public QObject
+{
+    Q_OBJECT
+
+  public:
+    ControlReader(const Config &cfg, const control::Block *block, QObject *parent = nullptr);
+
+    // replaces the driven fields of opt with the last values read
+    void apply(Config &opt) const;
+
+    QString report() const;
+
+  signals:
+    // emitted after a read changed how the crosshair looks
+    void changed();
+
+  private:
+    void poll();
+
+    const Config &m_config;
+    const control::Block *m_block;
+
+    QTimer m_timer;
+    control::State m_last;
+
+    qint64 m_polls = 0;
+    qint64 m_updates = 0;
+    qint64 m_retries = 0;
+    qint64 m_latencyTotal = 0;
+    qint64 m_latencyMax = 0;
+};
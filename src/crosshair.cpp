@@ -9,6 +9,7 @@
 #include "crosshair.h"
 
 #include "config.h"
+#include "pixel.h"
 #include <QGraphicsDropShadowEffect>
 #include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
@@ -16,6 +17,9 @@
 #include <QPainter>
 #include <QPen>
 #include <QPointF>
+#include <QRect>
+#include <QVarLengthArray>
+#include <cstring>
 
 namespace Crosshair
 {
@@ -57,29 +61,438 @@ QPainterPath buildPath(const Config &opt, const QSize &canvasSize)
     return path;
 }
 
-// renders the crosshair lines with thicknes color
-// shadow and the centerdot to a QPixmap
-QPixmap render(const Config &opt)
+// canvas size of the shape mask, big enough for the lines plus some margin
+static int canvasSize(const Config &opt)
 {
-    // calculate canvas size
-    const int size = (opt.length + opt.gap) * 2 + 100;
-    const QSize canvasSize(size, size);
+    return (opt.length + opt.gap) * 2 + 100;
+}
+
+// padding around the shape to avoid cutting off the shadow
+static int shadowPadding(const Config &opt)
+{
+    return opt.shadowBlurRadius + 2;
+}
+
+// all layer buffers share one frame with the crosshair centered in it. it
+// fits every config within the limits of Config::clamp() (length and gap 50,
+// shadow radius 24), so the buffers are allocated once and then reused
+static constexpr int minFrame = (50 + 50) * 2 + 100 + 2 * (24 + 2);
+
+static int frameSize(const Config &opt)
+{
+    int canvas = canvasSize(opt);
+    for (const Config::Layer &layer : opt.extraLayers)
+        canvas = qMax(canvas, (layer.length + layer.gap) * 2 + 100);
+
+    return qMax(minFrame, canvas + 2 * shadowPadding(opt));
+}
+
+// the options of the main crosshair replaced by the extra layer at index,
+// to render the layer with the same code as the main crosshair
+static Config layerConfig(const Config &opt, int index)
+{
+    Config layer = opt;
+    layer.setLayer(0, opt.extraLayers.at(index));
+    return layer;
+}
+
+// makes sure buffer is a frame sized image. returns true if it had to
+// be allocated, which only happens on first use or when the frame grew
+static bool reserve(QImage &buffer, int frame, QImage::Format format)
+{
+    if (buffer.width() == frame && buffer.format() == format)
+        return false;
+
+    buffer = pixel::allocate(QSize(frame, frame), format);
+    return true;
+}
+
+// the following helpers decide which cached layer can be reused,
+// each one compares only the options its layer depends on
+static bool sameShape(const Config &a, const Config &b)
+{
+    return a.length == b.length && a.gap == b.gap && a.thickness == b.thickness && a.dot == b.dot &&
+           a.dotSize == b.dotSize && a.devicePixelRatio == b.devicePixelRatio;
+}
+
+static bool sameShadow(const Config &a, const Config &b)
+{
+    return a.shadowBlurRadius == b.shadowBlurRadius;
+}
+
+static bool sameOutline(const Config &a, const Config &b)
+{
+    return a.outlineThickness == b.outlineThickness;
+}
+
+static bool sameComposite(const Config &a, const Config &b)
+{
+    return a.shadow == b.shadow && a.outline == b.outline && a.color == b.color && a.shadowColor == b.shadowColor &&
+           a.outlineColor == b.outlineColor && a.extraLayers == b.extraLayers;
+}
+
+// true if both configs produce the same crosshair image
+bool sameRender(const Config &a, const Config &b)
+{
+    return sameShape(a, b) && sameComposite(a, b) && (!a.shadow || sameShadow(a, b)) &&
+           (!a.outline || sameOutline(a, b));
+}
+
+// true if the arms of buildPath() cover whole pixels only. the canvas
+// center is always on a pixel edge, an even thickness keeps the arms on
+// pixel edges too, odd ones are shifted by half a pixel (which also moves
+// the arm ends) and any other pixel ratio scales them off the grid
+bool pixelAligned(const Config &opt)
+{
+    return opt.devicePixelRatio == 1.0 && opt.thickness % 2 == 0;
+}
+
+// writes the four arms of buildPath() directly into the canvas rect of
+// the mask as fully covered spans, matching what the anti aliased stroke
+// produces
+static void fillArms(QImage &mask, const QRect &canvas, const Config &opt)
+{
+    const int cx = canvas.x() + canvas.width() / 2;
+    const int cy = canvas.y() + canvas.height() / 2;
+    const int t = opt.thickness;
+    const int g = opt.gap;
+    const int L = opt.length;
+
+    pixel::fill(mask, QRect(cx - t / 2, cy - g - L, t, L), 255);
+    pixel::fill(mask, QRect(cx - t / 2, cy + g, t, L), 255);
+    pixel::fill(mask, QRect(cx - g - L, cy - t / 2, L, t), 255);
+    pixel::fill(mask, QRect(cx + g, cy - t / 2, L, t), 255);
+}
+
+// the center dot of the span fill path, painted into its own mask around
+// a pixel edge like in the shape. it is only painted again when its size
+// changes, so dragging the other sliders never needs a QPainter
+static const QImage &dotMask(Layers &layers, const Config &opt)
+{
+    if (layers.dotValid && layers.dotKey.dotSize == opt.dotSize)
+        return layers.dot;
+
+    // even, with a pixel of room for the anti aliased edge
+    const int size = opt.dotSize + 2 + opt.dotSize % 2;
+    if (layers.dot.width() < size)
+        layers.dot = pixel::allocate(QSize(size, size), QImage::Format_Alpha8);
+    else
+        layers.dot.fill(0);
+
+    QPainter painter(&layers.dot);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(Qt::white);
+
+    const QPointF c(layers.dot.width() / 2, layers.dot.height() / 2);
+    const qreal r = opt.dotSize / 2.0;
+
+    painter.drawEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+    painter.end();
+
+    layers.dotKey = opt;
+    layers.dotValid = true;
+
+    return layers.dot;
+}
+
+// rasterizes the crosshair lines and center dot into the 8 bit coverage
+// mask of the layers, the color is applied later in the composite. pixel
+// aligned arms are filled as spans unless spans is false, everything else
+// goes through the anti aliased QPainter stroke
+static void rasterize(Layers &layers, const Config &opt, int frame, bool spans)
+{
+    if (reserve(layers.shape, frame, QImage::Format_Alpha8))
+        layers.shapeRect = QRect();
+
+    QImage &mask = layers.shape;
+    const int size = canvasSize(opt);
+    const int origin = (frame - size) / 2;
+    const QRect rect(origin, origin, size, size);
+
+    // clear what the last shape left behind
+    pixel::clear(mask, layers.shapeRect);
+    layers.shapeRect = rect;
+    mask.setDevicePixelRatio(opt.devicePixelRatio);
+
+    if (spans && pixelAligned(opt))
+    {
+        fillArms(mask, rect, opt);
+
+        // the arms are either fully covered or empty, so the dot
+        // drawn over them is the same as the max of both
+        if (opt.dot && opt.dotSize > 0)
+        {
+            const QImage &dot = dotMask(layers, opt);
+            const QPoint center = rect.topLeft() + QPoint(size / 2, size / 2);
+            pixel::merge(mask, dot, dot.rect(), center - QPoint(dot.width() / 2, dot.height() / 2));
+        }
+        return;
+    }
+
+    const QSize canvas(size, size);
+    QPainter painter(&mask);
+    painter.translate(QPointF(rect.topLeft()) / opt.devicePixelRatio);
+
+    // enable anti aliasing to smooth the crosshair and center dot
+    // and remove flickering on thickness change due to the subpixel
+    // prevention in buildPath() func
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    QPen pen(Qt::white);
+    pen.setWidth(opt.thickness);
+    pen.setCapStyle(Qt::FlatCap);
+    pen.setJoinStyle(Qt::MiterJoin);
+
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPath(buildPath(opt, canvas));
+
+    // Draw center dot if enabled
+    if (opt.dot && opt.dotSize > 0)
+    {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::white);
+
+        const QPointF c(size / 2.0, size / 2.0);
+        const qreal r = opt.dotSize / 2.0;
+
+        painter.drawEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
+    }
+}
+
+// rasterizes just the shape of opt into layers, in a frame that fits opt
+void paintShape(Layers &layers, const Config &opt, bool spans)
+{
+    rasterize(layers, opt, qMax(frameSize(opt), layers.shape.width()), spans);
+}
+
+// unites the shapes of the main crosshair and all extra layers, the
+// shadow and the outline go around all of them
+static void mergeShapes(Layers &layers)
+{
+    if (reserve(layers.merged, layers.shape.width(), QImage::Format_Alpha8))
+        layers.mergedRect = QRect();
+
+    pixel::clear(layers.merged, layers.mergedRect);
+
+    QRect rect = layers.shapeRect;
+    pixel::merge(layers.merged, layers.shape, layers.shapeRect, layers.shapeRect.topLeft());
+
+    for (const Layers &extra : layers.extra)
+    {
+        pixel::merge(layers.merged, extra.shape, extra.shapeRect, extra.shapeRect.topLeft());
+        rect |= extra.shapeRect;
+    }
+
+    layers.mergedRect = rect;
+}
 
-    QImage base(canvasSize, QImage::Format_ARGB32_Premultiplied);
+// copies the coverage into the shadow mask and blurs it, padded around
+// it. the result is independent of the shadow color, so alpha changes
+// never blur again
+static void paintShadow(Layers &layers, const QImage &coverage, const QRect &rect, const Config &opt)
+{
+    if (reserve(layers.shadow, layers.shape.width(), QImage::Format_Alpha8))
+        layers.shadowRect = QRect();
+
+    const int pad = shadowPadding(opt);
+
+    pixel::clear(layers.shadow, layers.shadowRect);
+    layers.shadowRect = rect.adjusted(-pad, -pad, pad, pad);
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y)
+        std::memcpy(layers.shadow.scanLine(y) + rect.left(), coverage.constScanLine(y) + rect.left(), rect.width());
+
+    pixel::blur(layers.shadow, layers.shadowRect, opt.shadowBlurRadius);
+}
+
+// grows the coverage by the outline thickness. the canvas has enough
+// margin around the lines, so the outline stays inside of rect
+static void paintOutline(Layers &layers, const QImage &coverage, const QRect &rect, const Config &opt)
+{
+    if (reserve(layers.outline, layers.shape.width(), QImage::Format_Alpha8))
+        layers.outlineRect = QRect();
+
+    if (!rect.contains(layers.outlineRect))
+        pixel::clear(layers.outline, layers.outlineRect);
+    layers.outlineRect = rect;
+
+    const int radius = qRound(opt.outlineThickness * opt.devicePixelRatio);
+    pixel::dilate(coverage, layers.outline, rect, radius);
+}
+
+// renders the crosshair into the cached layers and returns the final image.
+// only the stages whose options changed since the last call are rebuilt:
+// geometry changes rasterize and blur again, a blur radius change only blurs
+// again, an outline width change only dilates again and color or alpha
+// changes only run the composite pass. every extra layer has its own cached
+// shape, so editing one layer doesn't rasterize the others. the layers are
+// frame sized buffers that are reused from render to render, the returned
+// image has the crosshair centered and is transparent outside of compositeRect
+const QImage &renderImage(const Config &opt, Layers &layers)
+{
+    const int frame = qMax(frameSize(opt), layers.shape.width());
+    bool shapesChanged = false;
+
+    if (!layers.shapeValid || layers.shape.width() != frame || !sameShape(layers.shapeKey, opt))
+    {
+        rasterize(layers, opt, frame, true);
+        layers.shapeKey = opt;
+        layers.shapeValid = true;
+        shapesChanged = true;
+    }
+
+    if (layers.extra.size() != size_t(opt.extraLayers.size()))
+    {
+        layers.extra.resize(opt.extraLayers.size());
+        shapesChanged = true;
+    }
+
+    for (int i = 0; i < opt.extraLayers.size(); ++i)
+    {
+        Layers &extra = layers.extra[i];
+        const Config layer = layerConfig(opt, i);
+
+        if (!extra.shapeValid || extra.shape.width() != frame || !sameShape(extra.shapeKey, layer))
+        {
+            rasterize(extra, layer, frame, true);
+            extra.shapeKey = layer;
+            extra.shapeValid = true;
+            shapesChanged = true;
+        }
+    }
+
+    if (shapesChanged)
+    {
+        layers.shadowValid = false;
+        layers.outlineValid = false;
+        layers.compositeValid = false;
+    }
+
+    // with extra layers the shadow and the outline are
+    // built from the union of all shapes
+    const QImage *coverage = &layers.shape;
+    QRect coverageRect = layers.shapeRect;
+
+    if (!layers.extra.empty())
+    {
+        if (shapesChanged)
+            mergeShapes(layers);
+
+        coverage = &layers.merged;
+        coverageRect = layers.mergedRect;
+    }
+
+    if (opt.shadow && (!layers.shadowValid || !sameShadow(layers.shadowKey, opt)))
+    {
+        paintShadow(layers, *coverage, coverageRect, opt);
+        layers.shadowKey = opt;
+        layers.shadowValid = true;
+        layers.compositeValid = false;
+    }
+
+    if (opt.outline && (!layers.outlineValid || !sameOutline(layers.outlineKey, opt)))
+    {
+        paintOutline(layers, *coverage, coverageRect, opt);
+        layers.outlineKey = opt;
+        layers.outlineValid = true;
+        layers.compositeValid = false;
+    }
+
+    if (layers.compositeValid && sameComposite(layers.compositeKey, opt))
+        return layers.composite;
+
+    if (reserve(layers.composite, frame, QImage::Format_ARGB32_Premultiplied))
+        layers.compositeRect = QRect();
+    layers.composite.setDevicePixelRatio(opt.devicePixelRatio);
+
+    // If shadow is disabled the output is just the tinted shapes,
+    // else it covers the padded shadow mask
+    const QRect rect = opt.shadow ? layers.shadowRect : coverageRect;
+
+    if (!rect.contains(layers.compositeRect))
+        pixel::clear(layers.composite, layers.compositeRect);
+
+    // bottom to top: shadow, outline, crosshair, extra layers
+    QVarLengthArray<pixel::Tint, 3 + Config::maxExtraLayers> tints;
+
+    if (opt.shadow)
+        tints.append({&layers.shadow, opt.shadowColor});
+    if (opt.outline)
+        tints.append({&layers.outline, opt.outlineColor});
+    tints.append({&layers.shape, opt.color});
+    for (int i = 0; i < opt.extraLayers.size(); ++i)
+        tints.append({&layers.extra[i].shape, opt.extraLayers.at(i).color});
+
+    pixel::composite(layers.composite, rect, tints.constData(), tints.size());
+
+    layers.compositeRect = rect;
+    layers.compositeKey = opt;
+    layers.compositeValid = true;
+    ++layers.serial;
+
+    return layers.composite;
+}
+
+// the outline of the reference, the coverage of base grown by taking the
+// max over the whole square window of every pixel. the same result as the
+// separable pixel::dilate, just computed the slow and obvious way
+static QImage outlineReference(const QImage &base, const Config &opt)
+{
+    const int radius = qRound(opt.outlineThickness * opt.devicePixelRatio);
+    const QColor color = opt.outlineColor;
+
+    QImage out(base.size(), QImage::Format_ARGB32_Premultiplied);
+    out.setDevicePixelRatio(base.devicePixelRatio());
+
+    for (int y = 0; y < base.height(); ++y)
+    {
+        QRgb *dst = reinterpret_cast<QRgb *>(out.scanLine(y));
+
+        for (int x = 0; x < base.width(); ++x)
+        {
+            int coverage = 0;
+            for (int yy = qMax(0, y - radius); yy <= qMin(base.height() - 1, y + radius); ++yy)
+            {
+                const QRgb *src = reinterpret_cast<const QRgb *>(base.constScanLine(yy));
+                for (int xx = qMax(0, x - radius); xx <= qMin(base.width() - 1, x + radius); ++xx)
+                    coverage = qMax(coverage, qAlpha(src[xx]));
+            }
+
+            const int alpha = color.alpha() * coverage / 255;
+            dst[x] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), alpha));
+        }
+    }
+
+    return out;
+}
+
+// the original single pass renderer, color, shape and shadow are all
+// painted at once. kept as the reference the layered pipeline is
+// compared against
+QPixmap renderReference(const Config &opt)
+{
+    // calculate canvas size, big enough for the largest layer
+    int size = canvasSize(opt);
+    for (int i = 0; i < opt.extraLayers.size(); ++i)
+        size = qMax(size, canvasSize(layerConfig(opt, i)));
+    const QSize canvas(size, size);
+
+    QImage base(canvas, QImage::Format_ARGB32_Premultiplied);
     base.setDevicePixelRatio(opt.devicePixelRatio);
     base.fill(Qt::transparent);
 
-    // Paint crosshair lines and center dot.
+    // Paint crosshair lines and center dot of every layer, bottom to top.
+    for (int i = 0; i <= opt.extraLayers.size(); ++i)
     {
-        QPainter painter(&base);
+        const Config layer = i == 0 ? opt : layerConfig(opt, i - 1);
 
-        // enable anti aliasing to smooth the crosshair and center dot
-        // and remove flickering on thickness change due to the subpixel
-        // prevention in buildPath() func
+        QPainter painter(&base);
         painter.setRenderHint(QPainter::Antialiasing, true);
 
-        QPen pen(opt.color);
-        pen.setWidth(opt.thickness);
+        QPen pen(layer.color);
+        pen.setWidth(layer.thickness);
         pen.setCapStyle(Qt::FlatCap);
         pen.setJoinStyle(Qt::MiterJoin);
 
@@ -87,32 +500,60 @@ QPixmap render(const Config &opt)
         painter.setBrush(Qt::NoBrush);
 
         // generate the painter path using previous func
-        QPainterPath path = buildPath(opt, canvasSize);
+        QPainterPath path = buildPath(layer, canvas);
         painter.drawPath(path);
 
         // Draw center dot if enabled
-        if (opt.dot && opt.dotSize > 0)
+        if (layer.dot && layer.dotSize > 0)
         {
             painter.setPen(Qt::NoPen);
-            painter.setBrush(opt.color);
+            painter.setBrush(layer.color);
 
             const QPointF c(base.width() / 2.0, base.height() / 2.0);
-            const qreal r = opt.dotSize / 2.0;
+            const qreal r = layer.dotSize / 2.0;
 
             painter.drawEllipse(QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r));
         }
     }
 
-    // If shadow is disabled, we can return
-    // the finished QPixmap here
-    if (!opt.shadow)
+    // If shadow and outline are disabled, we can
+    // return the finished QPixmap here
+    if (!opt.shadow && !opt.outline)
     {
         return QPixmap::fromImage(base);
     }
 
     // else, we have to generate the shadow aswell
-    QPixmap out = renderShadow(base, opt);
-    return out;
+    if (!opt.outline)
+    {
+        QPixmap out = renderShadow(base, opt);
+        return out;
+    }
+
+    // the outline goes between the shadow and the crosshair, so the
+    // crosshair is drawn once more on top of it. base is centered in
+    // the padded shadow image
+    QImage out;
+    if (opt.shadow)
+    {
+        out = renderShadow(base, opt).toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    else
+    {
+        out = QImage(base.size(), QImage::Format_ARGB32_Premultiplied);
+        out.setDevicePixelRatio(opt.devicePixelRatio);
+        out.fill(Qt::transparent);
+    }
+
+    const QPointF offset = QPointF((out.width() - base.width()) / 2, (out.height() - base.height()) / 2) /
+                           opt.devicePixelRatio;
+
+    QPainter painter(&out);
+    painter.drawImage(offset, outlineReference(base, opt));
+    painter.drawImage(offset, base);
+    painter.end();
+
+    return QPixmap::fromImage(out);
 }
 
 // this function takes the rendered crosshair/dot and applies
@@ -132,8 +573,8 @@ QPixmap renderShadow(const QImage &base, const Config &opt)
     item->setGraphicsEffect(effect);
 
     // add padding to avoid cutting off the shadow
-    const qreal shadowPadding = opt.shadowBlurRadius + 2;
-    QRectF bounds = item->boundingRect().adjusted(-shadowPadding, -shadowPadding, shadowPadding, shadowPadding);
+    const qreal pad = shadowPadding(opt);
+    QRectF bounds = item->boundingRect().adjusted(-pad, -pad, pad, pad);
     scene.setSceneRect(bounds);
 
     QImage out((bounds.size()).toSize(), QImage::Format_ARGB32_Premultiplied);
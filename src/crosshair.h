@@ -1,4 +1,3 @@
-
 /*
  * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
  *
@@ -14,15 +13,70 @@
 #include <QPainterPath>
 #include <QPixmap>
 #include <QPoint>
+#include <QRect>
 #include <QSize>
+#include <vector>
 
 namespace Crosshair
 {
 
+// cached intermediate results of the render pipeline. every layer remembers
+// the config it was built from, so a render only redoes the stages whose
+// inputs actually changed (e.g. a color change only re-runs the composite).
+// the layers are reusable buffers of the same frame size with the crosshair
+// centered, each rect is the part of its buffer that is currently in use
+struct Layers
+{
+    // 8 bit coverage mask of the crosshair lines and center dot
+    QImage shape;
+    QRect shapeRect;
+    Config shapeKey;
+    bool shapeValid = false;
+
+    // center dot of the span fill path, only repainted when its size changes
+    QImage dot;
+    Config dotKey;
+    bool dotValid = false;
+
+    // blurred 8 bit coverage mask of the shape, padded for the shadow
+    QImage shadow;
+    QRect shadowRect;
+    Config shadowKey;
+    bool shadowValid = false;
+
+    // dilated 8 bit coverage mask of the shape, within the rect of the shape
+    QImage outline;
+    QRect outlineRect;
+    Config outlineKey;
+    bool outlineValid = false;
+
+    // extra layers drawn on top of the main crosshair, only their shape
+    // and dot are used. merged is the union of all shapes, the shadow
+    // and the outline are built from it when there are extra layers
+    std::vector<Layers> extra;
+    QImage merged;
+    QRect mergedRect;
+
+    // tinted final image, serial counts how often it was rebuilt
+    QImage composite;
+    QRect compositeRect;
+    Config compositeKey;
+    bool compositeValid = false;
+    quint64 serial = 0;
+};
+
 QPainterPath buildPath(const Config &opt, const QSize &canvas);
 
-QPixmap render(const Config &opt);
+bool sameRender(const Config &a, const Config &b);
+
+bool pixelAligned(const Config &opt);
+
+void paintShape(Layers &layers, const Config &opt, bool spans = true);
+
+const QImage &renderImage(const Config &opt, Layers &layers);
+
+QPixmap renderReference(const Config &opt);
 
 QPixmap renderShadow(const QImage &base, const Config &opt);
 
-} // namespace Crosshair
\ No newline at end of file
+} // namespace Crosshair
@@ -0,0 +1,1847 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "diag.h"
+
+#include "ccode.h"
+#include "config.h"
+#include "contrast.h"
+#include "control.h"
+#include "crosshair.h"
+#include "heap.h"
+#include "mainwindow.h"
+#include "model.h"
+#include "pixel.h"
+#include "render.h"
+#include "similar.h"
+#include "sparse.h"
+#include "stats.h"
+#include <QApplication>
+#include <QBuffer>
+#include <QCheckBox>
+#include <QClipboard>
+#include <QColor>
+#include <QComboBox>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineEdit>
+#include <QList>
+#include <QPainter>
+#include <QPushButton>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QSlider>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextStream>
+#include <QTimer>
+#include <QtMath>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// mallinfo2 is new in glibc 2.33, the older mallinfo overflows past 2 GiB
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2
+#endif
+
+namespace diag
+{
+
+// tolerances of the render parity check. blur implementations are allowed
+// to differ slightly at the soft edges, the crosshair itself has to match
+static constexpr int pixelTolerance = 16;
+static constexpr double maxMismatchRatio = 0.01;
+static constexpr double maxPerceptualMean = 2.0;
+static constexpr int maxPerceptualError = 48;
+
+// time budgets per case in milliseconds, best of a few runs
+static constexpr double coldBudget = 10.0;
+static constexpr double warmBudget = 2.0;
+static constexpr int timingRuns = 3;
+
+// a renderer that is checked against Crosshair::renderReference. prepare runs
+// untimed before every timed render, runs is how often a case is timed
+struct Backend
+{
+    QString name;
+    double budget;
+    int runs;
+    std::function<void(const Config &, Crosshair::Layers &)> prepare;
+    std::function<const QImage &(const Config &, Crosshair::Layers &)> render;
+    Crosshair::Layers layers;
+};
+
+struct Comparison
+{
+    bool sizeMatch = true;
+    int maxDiff = 0;
+    double mismatchRatio = 0.0;
+    double perceptualMean = 0.0;
+    int perceptualMax = 0;
+};
+
+// builds the parameter grid over all the options the renderer reads.
+// devicePixelRatio and supersample stay at their defaults, nothing sets them yet
+static QList<Config> renderGrid()
+{
+    const QColor colors[] = {QColor(255, 255, 255), QColor(0, 0, 0), QColor(255, 0, 0), QColor(0, 255, 127),
+                             QColor(40, 90, 250)};
+    const int lengths[] = {1, 8, 50};
+    const int gaps[] = {0, 5, 50};
+    const int thicknesses[] = {1, 2, 3, 8};
+
+    struct Dot
+    {
+        bool enabled;
+        int size;
+    };
+    const Dot dots[] = {{false, 4}, {true, 1}, {true, 4}, {true, 17}};
+
+    struct Shadow
+    {
+        bool enabled;
+        int radius;
+        int alpha;
+    };
+    const Shadow shadows[] = {{false, 3, 255}, {true, 0, 255}, {true, 3, 255}, {true, 10, 128}, {true, 24, 40}};
+
+    QList<Config> grid;
+    int i = 0;
+
+    for (int length : lengths)
+        for (int gap : gaps)
+            for (int thickness : thicknesses)
+                for (const Dot &dot : dots)
+                    for (const Shadow &shadow : shadows)
+                    {
+                        Config opt;
+                        opt.color = colors[i++ % std::size(colors)];
+                        opt.length = length;
+                        opt.gap = gap;
+                        opt.thickness = thickness;
+                        opt.dot = dot.enabled;
+                        opt.dotSize = dot.size;
+                        opt.shadow = shadow.enabled;
+                        opt.shadowBlurRadius = shadow.radius;
+                        opt.shadowColor = QColor(0, 0, 0, shadow.alpha);
+                        grid.append(opt);
+                    }
+
+    // stacked layers, composited over and under each other with and without
+    // effects. the outline goes around all of them
+    const Config::Layer layers[] = {{QColor(255, 0, 0), 20, 10, 2, false, 4},
+                                    {QColor(0, 0, 0), 4, 0, 8, true, 6},
+                                    {QColor(40, 90, 250), 50, 50, 3, true, 17}};
+
+    for (int count = 0; count <= static_cast<int>(std::size(layers)); ++count)
+        for (const Shadow &shadow : {shadows[0], shadows[2]})
+            for (bool outline : {false, true})
+            {
+                Config opt;
+                opt.color = colors[i++ % std::size(colors)];
+                opt.shadow = shadow.enabled;
+                opt.shadowBlurRadius = shadow.radius;
+                opt.shadowColor = QColor(0, 0, 0, shadow.alpha);
+                opt.outline = outline;
+                opt.outlineThickness = 2;
+
+                for (int l = 0; l < count; ++l)
+                    opt.extraLayers.append(layers[l]);
+
+                grid.append(opt);
+            }
+
+    return grid;
+}
+
+// Rec. 709 luminance of a premultiplied pixel drawn over 50% gray,
+// used as a cheap perceptual measure of how visible a difference is
+static int luminanceOverGray(QRgb p)
+{
+    const int inv = 255 - qAlpha(p);
+    const int r = qRed(p) + 128 * inv / 255;
+    const int g = qGreen(p) + 128 * inv / 255;
+    const int b = qBlue(p) + 128 * inv / 255;
+
+    return (2126 * r + 7152 * g + 722 * b) / 10000;
+}
+
+// compares two premultiplied images and optionally writes an amplified
+// difference image
+static Comparison compare(const QImage &candidate, const QImage &reference, QImage *diff)
+{
+    Comparison result;
+
+    if (candidate.size() != reference.size())
+    {
+        result.sizeMatch = false;
+        return result;
+    }
+
+    if (diff)
+    {
+        *diff = QImage(reference.size(), QImage::Format_ARGB32);
+        diff->fill(Qt::black);
+    }
+
+    qint64 mismatches = 0;
+    qint64 perceptualSum = 0;
+
+    for (int y = 0; y < reference.height(); ++y)
+    {
+        const QRgb *a = reinterpret_cast<const QRgb *>(candidate.constScanLine(y));
+        const QRgb *b = reinterpret_cast<const QRgb *>(reference.constScanLine(y));
+
+        for (int x = 0; x < reference.width(); ++x)
+        {
+            const int d = qMax(qMax(qAbs(qAlpha(a[x]) - qAlpha(b[x])), qAbs(qRed(a[x]) - qRed(b[x]))),
+                               qMax(qAbs(qGreen(a[x]) - qGreen(b[x])), qAbs(qBlue(a[x]) - qBlue(b[x]))));
+            const int p = qAbs(luminanceOverGray(a[x]) - luminanceOverGray(b[x]));
+
+            result.maxDiff = qMax(result.maxDiff, d);
+            result.perceptualMax = qMax(result.perceptualMax, p);
+            perceptualSum += p;
+
+            if (d > pixelTolerance)
+                ++mismatches;
+
+            if (diff && d > 0)
+            {
+                const int v = qMin(255, d * 4);
+                diff->setPixel(x, y, d > pixelTolerance ? qRgb(v, 0, 0) : qRgb(v, v, v));
+            }
+        }
+    }
+
+    const double pixels = double(reference.width()) * reference.height();
+    result.mismatchRatio = mismatches / pixels;
+    result.perceptualMean = perceptualSum / pixels;
+
+    return result;
+}
+
+static bool passes(const Comparison &c)
+{
+    return c.sizeMatch && c.mismatchRatio <= maxMismatchRatio && c.perceptualMean <= maxPerceptualMean &&
+           c.perceptualMax <= maxPerceptualError;
+}
+
+// best of a few runs, so a single scheduler hiccup does not fail a case
+static double timeRender(Backend &backend, const Config &opt, QImage &out)
+{
+    double best = 0.0;
+
+    for (int run = 0; run < backend.runs; ++run)
+    {
+        if (backend.prepare)
+            backend.prepare(opt, backend.layers);
+
+        QElapsedTimer timer;
+        timer.start();
+        backend.render(opt, backend.layers);
+        const double ms = timer.nsecsElapsed() / 1e6;
+
+        best = run == 0 ? ms : qMin(best, ms);
+    }
+
+    // deep copy of the part in use, the cached image gets overwritten by the next render
+    out = backend.layers.composite.copy(backend.layers.compositeRect);
+    return best;
+}
+
+// renders every case of the parameter grid with each backend and compares the
+// result against the QPainter / QGraphicsScene reference renderer. a case fails
+// if it does not match within the tolerances above or exceeds its time budget.
+// pixel aligned cases also have to give the exact same shape mask with the
+// span fill fast path as with the painter stroke.
+// reference, candidate and difference images of failed cases are written into
+// diffDir. returns the process exit code
+int checkRender(const QString &diffDir)
+{
+    QTextStream out(stdout);
+
+    auto render = [](const Config &opt, Crosshair::Layers &layers) -> const QImage & {
+        return Crosshair::renderImage(opt, layers);
+    };
+
+    // a fresh cache every time measures a full render, the cached one checks that
+    // stepping through the grid only rebuilds what changed, and the recolor one
+    // renders with another color first so only the composite pass runs
+    QList<Backend> backends = {
+        {"layered", coldBudget, timingRuns, [](const Config &, Crosshair::Layers &layers) { layers = {}; }, render, {}},
+        {"layered-cached", coldBudget, 1, nullptr, render, {}},
+        {"recolor", warmBudget, timingRuns,
+         [](const Config &opt, Crosshair::Layers &layers) {
+             Config other = opt;
+             other.color = QColor(255 - opt.color.red(), 255 - opt.color.green(), 255 - opt.color.blue());
+             Crosshair::renderImage(other, layers);
+         },
+         render, {}},
+    };
+
+    const QList<Config> grid = renderGrid();
+    QDir dir(diffDir);
+    int failures = 0;
+    double referenceTotal = 0.0;
+    QList<double> backendTotal(backends.size(), 0.0);
+
+    for (int i = 0; i < grid.size(); ++i)
+    {
+        const Config &opt = grid[i];
+
+        QElapsedTimer timer;
+        timer.start();
+        const QImage reference = Crosshair::renderReference(opt).toImage().convertToFormat(
+            QImage::Format_ARGB32_Premultiplied);
+        referenceTotal += timer.nsecsElapsed() / 1e6;
+
+        for (int b = 0; b < backends.size(); ++b)
+        {
+            Backend &backend = backends[b];
+
+            QImage candidate;
+            const double ms = timeRender(backend, opt, candidate);
+            backendTotal[b] += ms;
+
+            candidate = candidate.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+            QImage diff;
+            const Comparison c = compare(candidate, reference, &diff);
+            const bool inBudget = ms <= backend.budget;
+
+            if (passes(c) && inBudget)
+                continue;
+
+            ++failures;
+            out << QString("FAIL case %1 [%2] %3\n").arg(i).arg(backend.name, ccode::generateCode(opt));
+            if (!c.sizeMatch)
+                out << QString("  size %1x%2, expected %3x%4\n")
+                           .arg(candidate.width())
+                           .arg(candidate.height())
+                           .arg(reference.width())
+                           .arg(reference.height());
+            else
+                out << QString("  max diff %1, mismatches %2%, perceptual mean %3 max %4\n")
+                           .arg(c.maxDiff)
+                           .arg(c.mismatchRatio * 100, 0, 'f', 3)
+                           .arg(c.perceptualMean, 0, 'f', 3)
+                           .arg(c.perceptualMax);
+            if (!inBudget)
+                out << QString("  took %1 ms, budget %2 ms\n").arg(ms, 0, 'f', 3).arg(backend.budget, 0, 'f', 3);
+
+            if (dir.mkpath("."))
+            {
+                const QString prefix = dir.filePath(QString("case-%1-%2-").arg(i).arg(backend.name));
+                reference.save(prefix + "reference.png");
+                candidate.save(prefix + "candidate.png");
+                if (c.sizeMatch)
+                    diff.save(prefix + "diff.png");
+            }
+        }
+    }
+
+    // the span fill fast path has to reproduce the anti aliased stroke exactly
+    int aligned = 0;
+    double spanTotal = 0.0;
+    double strokeTotal = 0.0;
+
+    for (int i = 0; i < grid.size(); ++i)
+    {
+        const Config &opt = grid[i];
+        if (!Crosshair::pixelAligned(opt))
+            continue;
+        ++aligned;
+
+        Crosshair::Layers spans;
+        Crosshair::Layers stroke;
+
+        QElapsedTimer timer;
+        timer.start();
+        Crosshair::paintShape(spans, opt, true);
+        spanTotal += timer.nsecsElapsed() / 1e6;
+
+        timer.start();
+        Crosshair::paintShape(stroke, opt, false);
+        strokeTotal += timer.nsecsElapsed() / 1e6;
+
+        if (spans.shape == stroke.shape)
+            continue;
+
+        ++failures;
+        out << QString("FAIL case %1 [span-fill] %2\n").arg(i).arg(ccode::generateCode(opt));
+        out << "  shape mask differs from the painter stroke\n";
+
+        if (dir.mkpath("."))
+        {
+            const QString prefix = dir.filePath(QString("case-%1-span-fill-").arg(i));
+            stroke.shape.copy(stroke.shapeRect).save(prefix + "reference.png");
+            spans.shape.copy(spans.shapeRect).save(prefix + "candidate.png");
+        }
+    }
+
+    out << QString("%1 cases, %2 backends, %3 failures\n").arg(grid.size()).arg(backends.size()).arg(failures);
+    out << QString("         reference: %1 ms/case\n").arg(referenceTotal / grid.size(), 0, 'f', 3);
+    for (int b = 0; b < backends.size(); ++b)
+        out << QString("  %1: %2 ms/case\n").arg(backends[b].name, 16).arg(backendTotal[b] / grid.size(), 0, 'f', 3);
+    if (aligned > 0)
+        out << QString("  shape of %1 pixel aligned cases: span fill %2 ms/case, stroke %3 ms/case\n")
+                   .arg(aligned)
+                   .arg(spanTotal / aligned, 0, 'f', 3)
+                   .arg(strokeTotal / aligned, 0, 'f', 3);
+
+    return failures == 0 ? 0 : 1;
+}
+
+// compares what the shadow and the outline add to a full render. every mode
+// is rendered from scratch a few hundred times per crosshair size, the
+// reference row is the QGraphicsScene shadow of the original renderer.
+// returns the process exit code
+int benchRender()
+{
+    QTextStream out(stdout);
+
+    constexpr int iterations = 200;
+
+    struct Mode
+    {
+        QString name;
+        std::function<void(const Config &)> render;
+        std::function<void(Config &)> setup;
+    };
+
+    auto layered = [](const Config &opt) {
+        Crosshair::Layers layers;
+        Crosshair::renderImage(opt, layers);
+    };
+
+    const QList<Mode> modes = {
+        {"plain", layered, [](Config &opt) { opt.shadow = false; }},
+        {"shadow (blur)", layered, [](Config &opt) { opt.shadow = true; }},
+        {"outline (dilate)", layered,
+         [](Config &opt) {
+             opt.shadow = false;
+             opt.outline = true;
+         }},
+        {"shadow + outline", layered,
+         [](Config &opt) {
+             opt.shadow = true;
+             opt.outline = true;
+         }},
+        {"reference shadow", [](const Config &opt) { Crosshair::renderReference(opt); },
+         [](Config &opt) { opt.shadow = true; }},
+    };
+
+    struct Size
+    {
+        QString name;
+        int length;
+        int gap;
+        int thickness;
+    };
+
+    const Size sizes[] = {{"small", 8, 4, 2}, {"default", 8, 32, 2}, {"large", 50, 50, 8}};
+
+    for (const Size &size : sizes)
+    {
+        out << QString("%1 (length %2, gap %3, thickness %4)\n")
+                   .arg(size.name)
+                   .arg(size.length)
+                   .arg(size.gap)
+                   .arg(size.thickness);
+
+        for (const Mode &mode : modes)
+        {
+            Config opt;
+            opt.length = size.length;
+            opt.gap = size.gap;
+            opt.thickness = size.thickness;
+            opt.shadowBlurRadius = 3;
+            opt.outlineThickness = 1;
+            mode.setup(opt);
+
+            // warm up caches and lazily initialized painter state
+            mode.render(opt);
+
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < iterations; ++i)
+                mode.render(opt);
+            const double us = timer.nsecsElapsed() / 1e3 / iterations;
+
+            out << QString("  %1: %2 us/render\n").arg(mode.name, 18).arg(us, 0, 'f', 1);
+        }
+    }
+
+    return 0;
+}
+
+// simulates dragging the sliders of the settings across their range and
+// back, like the MainWindow renders on every value. the first drag warms
+// up the buffers, the second one is counted and must not allocate in the
+// render path, neither on the heap (with glibc including every malloc of
+// Qt, see heap.cpp) nor new pixel buffers. odd thicknesses and dot sizes
+// are counted too, but they go through QPainter which allocates
+// internally, so they are only reported and not part of the check.
+// returns the process exit code
+int checkAlloc()
+{
+    QTextStream out(stdout);
+
+    out << (heap::coversMalloc() ? "counting malloc and operator new\n"
+                                 : "counting operator new only, malloc isn't replaced on this platform\n");
+
+    struct Drag
+    {
+        QString name;
+        int from;
+        int to;
+        int step;
+        bool required;
+        std::function<void(Config &, int)> set;
+    };
+
+    const QList<Drag> drags = {
+        {"length", 1, 50, 1, true, [](Config &opt, int v) { opt.length = v; }},
+        {"gap", 0, 50, 1, true, [](Config &opt, int v) { opt.gap = v; }},
+        {"thickness (even)", 2, 50, 2, true, [](Config &opt, int v) { opt.thickness = v; }},
+        {"shadow radius", 0, 24, 1, true, [](Config &opt, int v) { opt.shadowBlurRadius = v; }},
+        {"shadow alpha", 0, 255, 1, true, [](Config &opt, int v) { opt.shadowColor = QColor(0, 0, 0, v); }},
+        {"outline width", 1, 5, 1, true, [](Config &opt, int v) { opt.outlineThickness = v; }},
+        {"color", 0, 359, 1, true, [](Config &opt, int v) { opt.color = QColor::fromHsv(v, 255, 255); }},
+        {"thickness (odd)", 1, 49, 2, false, [](Config &opt, int v) { opt.thickness = v; }},
+        {"dot size", 0, 100, 1, false, [](Config &opt, int v) { opt.dotSize = v; }},
+    };
+
+    Config base;
+    base.shadow = true;
+    base.outline = true;
+
+    Crosshair::Layers layers;
+    int failures = 0;
+
+    for (const Drag &drag : drags)
+    {
+        Config opt = base;
+
+        auto sweep = [&]() {
+            int renders = 0;
+            for (int v = drag.from; v <= drag.to; v += drag.step, ++renders)
+            {
+                drag.set(opt, v);
+                Crosshair::renderImage(opt, layers);
+            }
+            for (int v = drag.to; v >= drag.from; v -= drag.step, ++renders)
+            {
+                drag.set(opt, v);
+                Crosshair::renderImage(opt, layers);
+            }
+            return renders;
+        };
+
+        sweep();
+
+        const qint64 heapBefore = heap::allocations();
+        const qint64 buffersBefore = pixel::allocations();
+        const int renders = sweep();
+        const qint64 heapAllocations = heap::allocations() - heapBefore;
+        const qint64 bufferAllocations = pixel::allocations() - buffersBefore;
+
+        const bool clean = heapAllocations == 0 && bufferAllocations == 0;
+        if (drag.required && !clean)
+            ++failures;
+
+        out << QString("%1 %2: %3 heap allocations, %4 pixel buffers in %5 renders\n")
+                   .arg(!drag.required ? "INFO" : clean ? "PASS" : "FAIL")
+                   .arg(drag.name)
+                   .arg(heapAllocations)
+                   .arg(bufferAllocations)
+                   .arg(renders);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// time the app gets to finish startup (first paints, window mapping)
+// before the idle check starts counting
+static constexpr int idleSettleTime = 1000;
+
+// runs the app with default settings and the settings window hidden, like
+// it sits in the tray during a game, and checks that the event loop doesn't
+// wake up, no timer fires and the overlay isn't repainted for the given
+// time. returns the process exit code
+int checkIdle(double seconds)
+{
+    QTextStream out(stdout);
+
+    EventStats stats;
+    stats.start();
+
+    // default settings, so the check neither depends on nor touches the saved config
+    Config conf;
+    conf.firstTime = false;
+
+    MainWindow window(conf);
+    window.setup();
+    window.hide();
+
+    QEventLoop loop;
+    QTimer::singleShot(idleSettleTime, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    stats.reset();
+
+    // the timer ending the measurement wakes the loop once itself,
+    // so the counters are read and corrected right when it fires
+    qint64 wakeups = 0;
+    qint64 timerEvents = 0;
+    qint64 paints = 0;
+
+    QTimer::singleShot(qRound(seconds * 1000), &loop, [&]() {
+        wakeups = qMax<qint64>(0, stats.wakeups() - 1);
+        timerEvents = qMax<qint64>(0, stats.timerEvents() - 1);
+        paints = stats.overlayPaints();
+        loop.quit();
+    });
+    loop.exec();
+
+    out << stats.report() << "\n";
+
+    const bool idle = wakeups == 0 && timerEvents == 0 && paints == 0;
+    out << QString("%1: %2 wakeups, %3 timer events, %4 overlay paints while idle\n")
+               .arg(idle ? "PASS" : "FAIL")
+               .arg(wakeups)
+               .arg(timerEvents)
+               .arg(paints);
+
+    return idle ? 0 : 1;
+}
+
+// feeds synthetic backgrounds through the adaptive color decision: uniform
+// black, white and grays around the switching point to check the hysteresis,
+// and a background that is bright only where the crosshair itself is, to
+// check that the overlay is left out of the measurement. every switch has to
+// be a recolor of the cached masks, never a new rasterization.
+// returns the process exit code
+int checkContrast()
+{
+    QTextStream out(stdout);
+
+    Config conf;
+    conf.adaptive = true;
+    conf.color = QColor(255, 255, 255);
+    conf.adaptiveColor = QColor(0, 0, 0);
+    conf.length = 8;
+    conf.gap = 0;
+    conf.thickness = 8;
+    conf.dot = true;
+    conf.dotSize = 20;
+    conf.shadow = false;
+
+    Crosshair::Layers layers;
+    ContrastSampler sampler(conf, layers);
+
+    // renders with the color the sampler picked, like the MainWindow does
+    auto render = [&]() {
+        Config opt = conf;
+        opt.color = sampler.activeColor();
+        Crosshair::renderImage(opt, layers);
+    };
+    render();
+
+    const qint64 shapeKey = layers.shape.cacheKey();
+    const QSize size = sampler.sampleSize();
+
+    auto uniform = [&](int gray) {
+        QImage image(size, QImage::Format_RGB32);
+        image.fill(qRgb(gray, gray, gray));
+        return image;
+    };
+
+    // bright only where the overlay covers the sampled region
+    QImage overlayOnly = uniform(0);
+    const QPoint offset(layers.composite.width() / 2 - size.width() / 2,
+                        layers.composite.height() / 2 - size.height() / 2);
+    for (int y = 0; y < size.height(); ++y)
+        for (int x = 0; x < size.width(); ++x)
+            if (layers.composite.pixel(x + offset.x(), y + offset.y()) != 0)
+                overlayOnly.setPixel(x, y, qRgb(255, 255, 255));
+
+    struct Case
+    {
+        QString name;
+        QImage background;
+        QColor expected;
+    };
+
+    const QList<Case> cases = {
+        {"black", uniform(0), conf.color},
+        {"white", uniform(255), conf.adaptiveColor},
+        {"gray 140 (hysteresis)", uniform(140), conf.adaptiveColor},
+        {"gray 110", uniform(110), conf.color},
+        {"gray 120 (hysteresis)", uniform(120), conf.color},
+        {"overlay only", overlayOnly, conf.color},
+        {"white again", uniform(255), conf.adaptiveColor},
+    };
+
+    int failures = 0;
+
+    for (const Case &c : cases)
+    {
+        if (sampler.feed(c.background))
+            render();
+
+        const bool rightColor = sampler.activeColor() == c.expected;
+        const bool recolorOnly = layers.shape.cacheKey() == shapeKey;
+
+        if (!rightColor || !recolorOnly)
+            ++failures;
+
+        out << QString("%1 %2: %3%4\n")
+                   .arg(rightColor && recolorOnly ? "PASS" : "FAIL")
+                   .arg(c.name)
+                   .arg(sampler.activeColor().name())
+                   .arg(recolorOnly ? "" : ", shape was rasterized again");
+    }
+
+    out << sampler.report() << "\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// a widget of the settings window by its object name
+template <typename T> static T *child(QWidget &window, const char *name)
+{
+    T *widget = window.findChild<T *>(name);
+    if (!widget)
+        qFatal("settings window has no widget %s", name);
+    return widget;
+}
+
+// drives the widgets of the settings window like a user would and counts
+// what every action causes. an action that changes the config has to
+// notify, render and save exactly once, no matter how many widgets show
+// the changed option. actions that change nothing must not do anything.
+// profile reloads render once but are never saved, and don't make the
+// next edit save anything but itself. the config is saved into a
+// temporary ini file instead of the real one, the profile lives next to it.
+// returns the process exit code
+int checkModel()
+{
+    QTextStream out(stdout);
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        out << "FAIL: no temporary directory for the config\n";
+        return 1;
+    }
+
+    Config conf;
+    conf.firstTime = false;
+
+    MainWindow window(conf);
+    ConfigModel &model = window.configModel();
+    model.setStorage(dir.filePath("config.ini"));
+
+    window.setup();
+    window.hide();
+
+    auto pasteCode = [&](const QString &code) {
+        emit child<QLineEdit>(window, "i_crosshairCode")->textEdited(code);
+    };
+
+    Config pasted;
+    pasted.length = 20;
+    pasted.gap = 3;
+    pasted.color = QColor(255, 0, 0);
+
+    // writes an option into the profile and waits until the watcher applied it
+    const QString profile = dir.filePath("profile.ini");
+    auto writeProfile = [&](const QString &key, int value) {
+        QSettings settings(profile, QSettings::IniFormat);
+        settings.setValue(key, value);
+    };
+    auto reloadProfile = [&](const QString &key, int value) {
+        const qint64 notifications = model.notifications();
+        writeProfile(key, value);
+
+        QElapsedTimer timer;
+        timer.start();
+        while (model.notifications() == notifications && timer.elapsed() < 2000)
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    };
+
+    // saves and renders are what expected applies to if they're -1
+    struct Action
+    {
+        QString name;
+        int expected;
+        std::function<void()> run;
+        int saves = -1;
+        int renders = -1;
+    };
+
+    const QList<Action> actions = {
+        {"length slider", 1, [&]() { child<QSlider>(window, "i_length")->setValue(20); }},
+        {"gap spinbox", 1, [&]() { child<QSpinBox>(window, "i_gap_2")->setValue(12); }},
+        {"dot checkbox", 1, [&]() { child<QCheckBox>(window, "i_dotEnabled")->click(); }},
+        {"shadow checkbox", 1, [&]() { child<QCheckBox>(window, "i_shadow")->click(); }},
+        {"outline checkbox", 1, [&]() { child<QCheckBox>(window, "i_outline")->click(); }},
+        {"outline width spinbox", 1, [&]() { child<QSpinBox>(window, "i_outlinewidth_2")->setValue(3); }},
+        {"dot size slider", 1, [&]() { child<QSlider>(window, "i_dotSize")->setValue(17); }},
+        {"paste code", 1, [&]() { pasteCode(ccode::generateCode(pasted)); }},
+        {"paste invalid code", 0, [&]() { pasteCode("not a code"); }},
+        {"reset", 1, [&]() { child<QPushButton>(window, "i_resetConf")->click(); }},
+        {"reset, already default", 0, [&]() { child<QPushButton>(window, "i_resetConf")->click(); }},
+        {"add layer", 1, [&]() { child<QPushButton>(window, "i_addLayer")->click(); }},
+        {"layer length slider", 1, [&]() { child<QSlider>(window, "i_length")->setValue(30); }},
+        {"select main layer", 0, [&]() { child<QComboBox>(window, "i_layer")->setCurrentIndex(0); }},
+        {"select extra layer", 0, [&]() { child<QComboBox>(window, "i_layer")->setCurrentIndex(1); }},
+        {"remove layer", 1, [&]() { child<QPushButton>(window, "i_removeLayer")->click(); }},
+        {"enable checkbox", 1, [&]() { child<QCheckBox>(window, "i_enableCrosshair")->click(); }},
+        {"watch profile", 1,
+         [&]() {
+             writeProfile("crosshair/gap", 9);
+             window.watchConfig(profile);
+         },
+         0},
+        {"length slider after profile", 1, [&]() { child<QSlider>(window, "i_length")->setValue(40); }},
+        {"profile reload", 1, [&]() { reloadProfile("crosshair/gap", 14); }, 0},
+        {"profile reload, same file", 0, [&]() { reloadProfile("crosshair/gap", 14); }, 0},
+        {"profile reload, outline width while off", 1, [&]() { reloadProfile("crosshair/outlineThickness", 4); },
+         0, 0},
+        {"paste invalid code after reload", 0, [&]() { pasteCode("not a code"); }},
+        {"dot size slider after reload", 1, [&]() { child<QSlider>(window, "i_dotSize")->setValue(23); }},
+    };
+
+    int failures = 0;
+
+    for (const Action &action : actions)
+    {
+        const qint64 notifications = model.notifications();
+        const qint64 renders = window.renderCount();
+        const qint64 saves = model.saves();
+
+        action.run();
+
+        const qint64 n = model.notifications() - notifications;
+        const qint64 r = window.renderCount() - renders;
+        const qint64 s = model.saves() - saves;
+
+        const int expectedSaves = action.saves < 0 ? action.expected : action.saves;
+        const int expectedRenders = action.renders < 0 ? action.expected : action.renders;
+        const bool ok = n == action.expected && r == expectedRenders && s == expectedSaves;
+        if (!ok)
+            ++failures;
+
+        out << QString("%1 %2: %3 notifications, %4 renders, %5 saves (expected %6, %7 renders, %8 saves)\n")
+                   .arg(ok ? "PASS" : "FAIL")
+                   .arg(action.name)
+                   .arg(n)
+                   .arg(r)
+                   .arg(s)
+                   .arg(action.expected)
+                   .arg(expectedRenders)
+                   .arg(expectedSaves);
+    }
+
+    // the profile options without a visible effect were applied too,
+    // so the saves after the reload keep them
+    QSettings saved(dir.filePath("config.ini"), QSettings::IniFormat);
+    const int outlineThickness = saved.value("crosshair/outlineThickness").toInt();
+    const bool kept = outlineThickness == 4;
+    if (!kept)
+        ++failures;
+
+    out << QString("%1 saved outline width after reload: %2 (expected 4)\n")
+               .arg(kept ? "PASS" : "FAIL")
+               .arg(outlineThickness);
+
+    out << model.report() << "\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// writes the seqlock stress test of --check-control goes through
+static constexpr int controlWrites = 200000;
+
+// a control state whose every field follows from n, so a snapshot
+// mixing two writes can be told apart from a consistent one
+static control::State controlState(quint32 n)
+{
+    control::State state;
+    state.fields = control::Visible | control::Color | control::Length | control::Gap | control::Thickness |
+                   control::Dot | control::DotSize;
+    state.visible = n % 2;
+    state.color = n & 0xffffff;
+    state.length = int(n % 1000);
+    state.gap = int(n % 1000) + 1;
+    state.thickness = int(n % 1000) + 2;
+    state.dot = n % 3 == 0;
+    state.dotSize = int(n % 1000) + 3;
+    state.stamp = n;
+    return state;
+}
+
+static bool sameState(const control::State &a, const control::State &b)
+{
+    return a.fields == b.fields && a.visible == b.visible && a.color == b.color && a.length == b.length &&
+           a.gap == b.gap && a.thickness == b.thickness && a.dot == b.dot && a.dotSize == b.dotSize &&
+           a.stamp == b.stamp;
+}
+
+// checks the control block: a second thread writes as fast as it can while
+// this one reads, and every snapshot has to come from a single write. a
+// write left in progress has to make the reader retry and give up. then a
+// MainWindow reads driven fields from the block, which have to override
+// only the flagged fields of what is rendered and never reach the config
+// of the model or what it saves. returns the process exit code
+int checkControl()
+{
+    QTextStream out(stdout);
+    int failures = 0;
+
+    auto report = [&](bool ok, const QString &line) {
+        if (!ok)
+            ++failures;
+        out << (ok ? "PASS " : "FAIL ") << line << "\n";
+    };
+
+    control::Block block{};
+    block.magic = control::magic;
+    block.version = control::version;
+
+    // concurrent writes
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (quint32 n = 1; n <= quint32(controlWrites); ++n)
+            control::write(&block, controlState(n));
+        done.store(true, std::memory_order_release);
+    });
+
+    qint64 reads = 0;
+    qint64 failedReads = 0;
+    qint64 torn = 0;
+    qint64 mixed = 0;
+    qint64 backwards = 0;
+    quint32 lastSequence = 0;
+
+    while (!done.load(std::memory_order_acquire))
+    {
+        control::State state;
+        int retries = 0;
+        const bool ok = control::read(&block, state, &retries);
+        torn += retries;
+
+        if (!ok)
+        {
+            ++failedReads;
+            continue;
+        }
+
+        // the zeroed block before the first write
+        if (state.sequence == 0)
+            continue;
+
+        ++reads;
+        if ((state.sequence & 1) || !sameState(state, controlState(quint32(state.stamp))))
+            ++mixed;
+        if (state.sequence < lastSequence)
+            ++backwards;
+        lastSequence = state.sequence;
+    }
+    writer.join();
+
+    report(mixed == 0 && backwards == 0 && reads > 0,
+           QString("concurrent reads: %1 snapshots, %2 mixed, %3 out of order, %4 torn reads retried, "
+                   "%5 reads gave up")
+               .arg(reads)
+               .arg(mixed)
+               .arg(backwards)
+               .arg(torn)
+               .arg(failedReads));
+
+    control::State last;
+    report(control::read(&block, last) && sameState(last, controlState(controlWrites)),
+           "the last write is read back");
+
+    // a writer that died in the middle of a write
+    const quint32 sequence = block.sequence.load(std::memory_order_relaxed);
+    block.sequence.store(sequence + 1, std::memory_order_release);
+
+    control::State stale;
+    int retries = 0;
+    const bool staleRead = control::read(&block, stale, &retries);
+    report(!staleRead && retries > 0, QString("write in progress: read gave up after %1 retries").arg(retries));
+
+    block.sequence.store(sequence + 2, std::memory_order_release);
+
+    // the override in the MainWindow
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        out << "FAIL: no temporary directory for the config\n";
+        return 1;
+    }
+
+    Config conf;
+    conf.firstTime = false;
+
+    MainWindow window(conf);
+    ConfigModel &model = window.configModel();
+    model.setStorage(dir.filePath("config.ini"));
+
+    window.setup();
+    window.hide();
+    window.enableControl(&block);
+
+    const Config configured = model.config();
+    const qint64 saves = model.saves();
+
+    // length is written but not flagged, so it must not be driven
+    control::State driven;
+    driven.fields = control::Gap | control::Color;
+    driven.gap = configured.gap == 12 ? 13 : 12;
+    driven.color = qRgb(255, 0, 0);
+    driven.length = configured.length + 10;
+
+    auto drive = [&]() {
+        const qint64 renders = window.renderCount();
+        control::write(&block, driven);
+        return QTest::qWaitFor([&]() { return window.renderCount() > renders; }, 1000);
+    };
+
+    auto overridden = [&](const Config &cfg) {
+        const Config &shown = window.renderedOptions();
+        return shown.gap == driven.gap && shown.color == QColor(255, 0, 0) && shown.length == cfg.length;
+    };
+
+    const bool rendered = drive();
+    report(rendered && overridden(configured), "driven gap and color are rendered, the length is not");
+    report(model.config() == configured && model.saves() == saves, "the config of the model is untouched");
+
+    // an edit renders and saves the configured values, the driven ones
+    // still win in the render
+    child<QSlider>(window, "i_length")->setValue(configured.length + 3);
+
+    QSettings saved(dir.filePath("config.ini"), QSettings::IniFormat);
+    const int savedGap = saved.value("crosshair/gap").toInt();
+    const QColor savedColor = saved.value("crosshair/color").value<QColor>();
+
+    report(overridden(model.config()), "the override outlives an edit");
+    report(savedGap == configured.gap && savedColor == configured.color,
+           QString("saved gap %1 and color %2 after an edit (expected %3 and %4)")
+               .arg(savedGap)
+               .arg(savedColor.name())
+               .arg(configured.gap)
+               .arg(configured.color.name()));
+
+    return failures == 0 ? 0 : 1;
+}
+
+// runs the paint events of the overlay from the event filter itself, to
+// know when its new content was painted into the backing store and is
+// ready to be flushed to the screen
+class PaintProbe : public QObject
+{
+  public:
+    PaintProbe(const QElapsedTimer &clock) : m_clock(clock)
+    {
+    }
+
+    // clock time the last paint finished, -1 if none since the reset
+    qint64 painted = -1;
+
+  protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() != QEvent::Paint)
+            return false;
+
+        watched->event(event);
+        painted = m_clock.nsecsElapsed();
+        return true;
+    }
+
+  private:
+    const QElapsedTimer &m_clock;
+};
+
+// mean, percentiles (nearest rank) and maximum of samples in microseconds
+static QJsonObject summarize(QList<double> samples)
+{
+    QJsonObject summary;
+    if (samples.isEmpty())
+        return summary;
+
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&samples](double p) {
+        const int rank = qCeil(p * samples.size()) - 1;
+        return samples[std::clamp(rank, 0, int(samples.size()) - 1)];
+    };
+
+    summary["mean"] = std::accumulate(samples.cbegin(), samples.cend(), 0.0) / samples.size();
+    summary["p50"] = percentile(0.50);
+    summary["p90"] = percentile(0.90);
+    summary["p99"] = percentile(0.99);
+    summary["max"] = samples.last();
+    return summary;
+}
+
+// milliseconds a single input gets to show up on the overlay before it counts as lost
+static constexpr int presentTimeout = 1000;
+
+// clicks and types into the widgets of a shown settings window with QTest and
+// measures how long it takes until the overlay painted the new crosshair.
+// the stages are what the model and the MainWindow timed of the change:
+// input is the event dispatch and widget logic up to the commit, widgets
+// what showChanges spent besides code and render (spin boxes, code field,
+// overlay invalidation) and present the wait for the overlay paint. prints
+// json with the latency percentiles and stage breakdown per action in
+// microseconds. saves into a temporary ini file.
+// returns the process exit code
+int benchLatency(int samples)
+{
+    QTextStream out(stdout);
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        qWarning() << "no temporary directory for the config";
+        return 1;
+    }
+
+    Config conf;
+    conf.firstTime = false;
+
+    MainWindow window(conf);
+    ConfigModel &model = window.configModel();
+    model.setStorage(dir.filePath("config.ini"));
+
+    window.setup();
+    window.show();
+
+    CrosshairRenderer *overlay = nullptr;
+    for (QWidget *widget : QApplication::topLevelWidgets())
+        if (CrosshairRenderer *renderer = qobject_cast<CrosshairRenderer *>(widget))
+            overlay = renderer;
+
+    if (!overlay)
+    {
+        qWarning() << "no crosshair overlay";
+        return 1;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+
+    PaintProbe probe(clock);
+    overlay->installEventFilter(&probe);
+
+    QSlider *length = child<QSlider>(window, "i_length");
+    QSpinBox *gap = child<QSpinBox>(window, "i_gap_2");
+    QLineEdit *code = child<QLineEdit>(window, "i_crosshairCode");
+    QPushButton *reset = child<QPushButton>(window, "i_resetConf");
+
+    // codes pasted in turns, so every paste changes the crosshair
+    Config pasted[2];
+    pasted[0].length = 20;
+    pasted[0].gap = 3;
+    pasted[1].color = QColor(0, 255, 127);
+    pasted[1].thickness = 4;
+    const QString codes[2] = {ccode::generateCode(pasted[0]), ccode::generateCode(pasted[1])};
+
+    struct Action
+    {
+        QString name;
+        std::function<void(int)> prepare;
+        std::function<void(int)> input;
+    };
+
+    // the slider and the spin box sweep up and down their range, one step per event
+    auto sweep = [](int value, int minimum, int maximum, int &direction) {
+        if (value + direction > maximum || value + direction < minimum)
+            direction = -direction;
+        return direction > 0;
+    };
+    int lengthDirection = 1;
+    int gapDirection = 1;
+
+    const QList<Action> actions = {
+        {"slider drag", [](int) {},
+         [&](int) {
+             const bool up = sweep(length->value(), length->minimum(), length->maximum(), lengthDirection);
+             QTest::keyClick(length, up ? Qt::Key_Right : Qt::Key_Left);
+         }},
+        {"spin box edit", [](int) {},
+         [&](int) {
+             const bool up = sweep(gap->value(), gap->minimum(), gap->maximum(), gapDirection);
+             QTest::keyClick(gap, up ? Qt::Key_Up : Qt::Key_Down);
+         }},
+        {"code paste",
+         [&](int i) {
+             QGuiApplication::clipboard()->setText(codes[i % 2]);
+             code->selectAll();
+         },
+         [&](int) { QTest::keyClick(code, Qt::Key_V, Qt::ControlModifier); }},
+        {"reset", [&](int i) { length->setValue(10 + i % 30); },
+         [&](int) { QTest::mouseClick(reset, Qt::LeftButton); }},
+    };
+
+    // the first samples of every action warm up caches and are thrown away
+    constexpr int warmup = 10;
+
+    QJsonObject results;
+
+    for (const Action &action : actions)
+    {
+        QList<double> total, input, widgets, codeGen, render, save, present;
+        int lost = 0;
+
+        for (int i = 0; i < warmup + samples; ++i)
+        {
+            action.prepare(i);
+            QCoreApplication::processEvents();
+            probe.painted = -1;
+
+            const qint64 t0 = clock.nsecsElapsed();
+            action.input(i);
+            const qint64 t1 = clock.nsecsElapsed();
+
+            QTest::qWaitFor([&]() { return probe.painted >= 0; }, presentTimeout);
+
+            if (i < warmup)
+                continue;
+
+            if (probe.painted < 0)
+            {
+                ++lost;
+                continue;
+            }
+
+            const qint64 notify = model.notifyTime();
+            total.append((probe.painted - t0) / 1e3);
+            input.append((t1 - t0 - notify - model.saveTime()) / 1e3);
+            widgets.append((notify - window.codeTime() - window.renderTime()) / 1e3);
+            codeGen.append(window.codeTime() / 1e3);
+            render.append(window.renderTime() / 1e3);
+            save.append(model.saveTime() / 1e3);
+            present.append((probe.painted - t1) / 1e3);
+        }
+
+        QJsonObject stages;
+        stages["input"] = summarize(input);
+        stages["widgets"] = summarize(widgets);
+        stages["code"] = summarize(codeGen);
+        stages["render"] = summarize(render);
+        stages["save"] = summarize(save);
+        stages["present"] = summarize(present);
+
+        QJsonObject result;
+        result["samples"] = int(total.size());
+        result["lost"] = lost;
+        result["latency"] = summarize(total);
+        result["stages"] = stages;
+        results[action.name] = result;
+    }
+
+    QJsonObject root;
+    root["platform"] = QGuiApplication::platformName();
+    root["unit"] = "us";
+    root["actions"] = results;
+
+    out << QJsonDocument(root).toJson(QJsonDocument::Indented);
+    return 0;
+}
+
+// span encodes the renders of the whole parameter grid and checks that the
+// runs expand, blit and go through a snapshot bit identical to the dense
+// image. reports the memory of the dense frames against the runs and the
+// snapshot and png sizes, and the time of blitting the runs against drawing
+// the dense frame with QPainter. returns the process exit code
+int checkSparse()
+{
+    QTextStream out(stdout);
+
+    const QList<Config> grid = renderGrid();
+    Crosshair::Layers layers;
+    sparse::Image encoded;
+
+    int failures = 0;
+    qint64 denseBytes = 0;
+    qint64 sparseBytes = 0;
+    qint64 snapshotBytes = 0;
+    qint64 pngBytes = 0;
+    double blitTime = 0.0;
+    double drawTime = 0.0;
+
+    for (int i = 0; i < grid.size(); ++i)
+    {
+        const QImage &image = Crosshair::renderImage(grid[i], layers);
+        sparse::encode(image, layers.compositeRect, encoded);
+
+        QBuffer snapshot;
+        snapshot.open(QIODevice::ReadWrite);
+        sparse::write(encoded, snapshot);
+        snapshot.seek(0);
+
+        sparse::Image restored;
+        const bool readable = sparse::read(snapshot, restored);
+
+        QImage blitted(image.size(), QImage::Format_ARGB32_Premultiplied);
+        blitted.fill(Qt::transparent);
+        blitted.setDevicePixelRatio(image.devicePixelRatio());
+
+        QElapsedTimer timer;
+        timer.start();
+        sparse::blit(encoded, blitted, QPoint(0, 0), blitted.rect());
+        blitTime += timer.nsecsElapsed() / 1e6;
+
+        QImage drawn(image.size(), QImage::Format_ARGB32_Premultiplied);
+        drawn.fill(Qt::transparent);
+        {
+            QPainter painter(&drawn);
+            timer.start();
+            painter.drawImage(QPoint(0, 0), image);
+            drawTime += timer.nsecsElapsed() / 1e6;
+        }
+
+        const bool expanded = sparse::expand(encoded) == image;
+        const bool blits = blitted == image;
+        const bool restores = readable && sparse::expand(restored) == image;
+
+        if (!expanded || !blits || !restores)
+        {
+            ++failures;
+            out << QString("FAIL case %1:%2%3%4\n")
+                       .arg(i)
+                       .arg(expanded ? "" : " expand differs")
+                       .arg(blits ? "" : " blit differs")
+                       .arg(restores ? "" : " snapshot differs");
+        }
+
+        QBuffer png;
+        png.open(QIODevice::WriteOnly);
+        image.copy(encoded.isEmpty() ? QRect(0, 0, 1, 1) : encoded.rect()).save(&png, "png");
+
+        denseBytes += image.sizeInBytes();
+        sparseBytes += encoded.bytes();
+        snapshotBytes += snapshot.size();
+        pngBytes += png.size();
+    }
+
+    // snapshots with a pixel ratio the overlay can't divide by or lay out
+    for (double dpr : {0.0, -1.0, std::nan(""), std::numeric_limits<double>::infinity(), 1e9})
+    {
+        sparse::Image crafted = encoded;
+        crafted.devicePixelRatio = dpr;
+
+        QBuffer snapshot;
+        snapshot.open(QIODevice::ReadWrite);
+        sparse::write(crafted, snapshot);
+        snapshot.seek(0);
+
+        sparse::Image restored;
+        if (sparse::read(snapshot, restored))
+        {
+            ++failures;
+            out << QString("FAIL snapshot with pixel ratio %1 was read\n").arg(dpr);
+        }
+    }
+
+    const int cases = grid.size();
+    out << QString("%1 cases, %2 failed\n").arg(cases).arg(failures);
+    out << QString("  memory: %1 KiB dense frames, %2 KiB runs (%3x smaller)\n")
+               .arg(denseBytes / 1024)
+               .arg(sparseBytes / 1024)
+               .arg(double(denseBytes) / qMax<qint64>(1, sparseBytes), 0, 'f', 1);
+    out << QString("  disk: %1 KiB snapshots (%2x smaller than dense), %3 KiB cropped pngs\n")
+               .arg(snapshotBytes / 1024)
+               .arg(double(denseBytes) / qMax<qint64>(1, snapshotBytes), 0, 'f', 1)
+               .arg(pngBytes / 1024);
+    out << QString("  blit: %1 us/case runs, %2 us/case QPainter over the dense frame\n")
+               .arg(blitTime * 1e3 / cases, 0, 'f', 1)
+               .arg(drawTime * 1e3 / cases, 0, 'f', 1);
+
+    out << (failures == 0 ? "PASS" : "FAIL") << "\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// a random crosshair over the ranges people actually use
+static Config randomConfig(QRandomGenerator &rng)
+{
+    Config opt;
+    opt.color = QColor::fromRgb(rng.bounded(0x1000000));
+    opt.length = rng.bounded(1, 51);
+    opt.gap = rng.bounded(0, 51);
+    opt.thickness = rng.bounded(1, 9);
+    opt.dot = rng.bounded(2) == 1;
+    opt.dotSize = rng.bounded(1, 21);
+    opt.shadow = rng.bounded(2) == 1;
+    opt.shadowBlurRadius = rng.bounded(0, 25);
+    opt.shadowColor = QColor(0, 0, 0, rng.bounded(256));
+    return opt;
+}
+
+// builds the similarity index over count random presets, once balanced
+// from the parsed codes like a presets file is loaded and once by inserting
+// them one by one, and times nearest and range queries on both against a
+// linear scan over the feature points and a scan that parses every code
+// again. the k nearest of the index have to match the linear scan.
+// returns the process exit code
+int benchSimilar(int count)
+{
+    QTextStream out(stdout);
+
+    constexpr int queries = 1000;
+    constexpr int k = 8;
+    constexpr float radius = 0.1f;
+    constexpr int checkedQueries = 100;
+    constexpr int parsedQueries = 3;
+
+    QRandomGenerator rng(20250101);
+
+    QStringList codes;
+    codes.reserve(count);
+    for (int i = 0; i < count; ++i)
+        codes.append(ccode::generateCode(randomConfig(rng)));
+
+    QList<similar::Point> targets;
+    for (int i = 0; i < queries; ++i)
+        targets.append(similar::features(randomConfig(rng)));
+
+    QElapsedTimer timer;
+
+    // like Presets::load without the file
+    timer.start();
+    std::vector<similar::Point> points;
+    points.reserve(count);
+    for (const QString &code : codes)
+    {
+        Config opt;
+        ccode::applyCode(code, opt);
+        opt.clamp();
+        points.push_back(similar::features(opt));
+    }
+    const double parseMs = timer.nsecsElapsed() / 1e6;
+
+    timer.start();
+    similar::Index built;
+    built.build(points);
+    const double buildMs = timer.nsecsElapsed() / 1e6;
+
+    timer.start();
+    similar::Index inserted;
+    for (const similar::Point &point : points)
+        inserted.insert(point);
+    const double insertMs = timer.nsecsElapsed() / 1e6;
+
+    out << QString("%1 presets: parse %2 ms, balanced build %3 ms, incremental insert %4 ms\n")
+               .arg(count)
+               .arg(parseMs, 0, 'f', 1)
+               .arg(buildMs, 0, 'f', 1)
+               .arg(insertMs, 0, 'f', 1);
+
+    // microseconds per query, sorted
+    auto timeQueries = [&](const std::function<void(const similar::Point &)> &query, int n) {
+        QList<double> times;
+        for (int i = 0; i < n; ++i)
+        {
+            timer.start();
+            query(targets[i]);
+            times.append(timer.nsecsElapsed() / 1e3);
+        }
+        std::sort(times.begin(), times.end());
+        return times;
+    };
+
+    auto report = [&](const QString &name, const QList<double> &times) {
+        const double mean = std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+        out << QString("  %1: mean %2 us, p50 %3 us, p99 %4 us\n")
+                   .arg(name, -28)
+                   .arg(mean, 0, 'f', 2)
+                   .arg(times[times.size() / 2], 0, 'f', 2)
+                   .arg(times[qMin(times.size() - 1, times.size() * 99 / 100)], 0, 'f', 2);
+    };
+
+    size_t found = 0;
+    report(QString("%1 nearest, balanced").arg(k),
+           timeQueries([&](const similar::Point &q) { found += built.nearest(q, k).size(); }, queries));
+    report(QString("%1 nearest, inserted").arg(k),
+           timeQueries([&](const similar::Point &q) { found += inserted.nearest(q, k).size(); }, queries));
+    report(QString("within %1, balanced").arg(radius),
+           timeQueries([&](const similar::Point &q) { found += built.within(q, radius).size(); }, queries));
+
+    // the same without an index, over the points and over the codes
+    auto linear = [&](const std::vector<similar::Point> &over, const similar::Point &q) {
+        std::vector<similar::Match> all(over.size());
+        for (size_t i = 0; i < over.size(); ++i)
+        {
+            float sum = 0.0f;
+            for (int d = 0; d < similar::dimensions; ++d)
+                sum += (q[d] - over[i][d]) * (q[d] - over[i][d]);
+            all[i] = {int(i), std::sqrt(sum)};
+        }
+
+        const size_t n = qMin(all.size(), size_t(k));
+        std::partial_sort(all.begin(), all.begin() + n, all.end(),
+                          [](const similar::Match &a, const similar::Match &b) { return a.distance < b.distance; });
+        all.resize(n);
+        return all;
+    };
+
+    auto parsing = [&](const similar::Point &q) {
+        std::vector<similar::Point> parsed;
+        parsed.reserve(codes.size());
+        for (const QString &code : codes)
+        {
+            Config opt;
+            ccode::applyCode(code, opt);
+            opt.clamp();
+            parsed.push_back(similar::features(opt));
+        }
+        return linear(parsed, q);
+    };
+
+    report(QString("%1 nearest, linear scan").arg(k),
+           timeQueries([&](const similar::Point &q) { found += linear(points, q).size(); }, checkedQueries));
+    report(QString("%1 nearest, parsing codes").arg(k),
+           timeQueries([&](const similar::Point &q) { found += parsing(q).size(); }, parsedQueries));
+
+    // the same distances as the linear scan (indices may differ on ties)
+    int mismatches = 0;
+    for (int i = 0; i < checkedQueries; ++i)
+    {
+        const std::vector<similar::Match> expected = linear(points, targets[i]);
+        const std::vector<similar::Match> a = built.nearest(targets[i], k);
+        const std::vector<similar::Match> b = inserted.nearest(targets[i], k);
+
+        bool same = a.size() == expected.size() && b.size() == expected.size();
+        for (size_t j = 0; same && j < expected.size(); ++j)
+            same = qAbs(a[j].distance - expected[j].distance) < 1e-5f &&
+                   qAbs(b[j].distance - expected[j].distance) < 1e-5f;
+
+        if (!same)
+            ++mismatches;
+    }
+
+    out << QString("%1: %2 of %3 queries differ from the linear scan (%4 results)\n")
+               .arg(mismatches == 0 ? "PASS" : "FAIL")
+               .arg(mismatches)
+               .arg(checkedQueries)
+               .arg(found);
+
+    return mismatches == 0 ? 0 : 1;
+}
+
+// resident memory of the process in bytes, -1 where it isn't known
+static qint64 residentSize()
+{
+#if defined(Q_OS_LINUX)
+    // the second field of statm is the resident size in pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+
+    const QList<QByteArray> fields = statm.readAll().simplified().split(' ');
+    if (fields.size() < 2)
+        return -1;
+
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+
+    return qint64(counters.WorkingSetSize);
+#else
+    return -1;
+#endif
+}
+
+// bytes the allocator handed out and keeps free inside of its arenas.
+// free but not returned memory growing while the used part stays flat
+// is fragmentation. both -1 without glibc
+struct HeapUsage
+{
+    qint64 used = -1;
+    qint64 free = -1;
+};
+
+static HeapUsage heapUsage()
+{
+    HeapUsage usage;
+#ifdef HAVE_MALLINFO2
+    const struct mallinfo2 info = mallinfo2();
+    usage.used = qint64(info.uordblks + info.hblkhd);
+    usage.free = qint64(info.fordblks);
+#endif
+    return usage;
+}
+
+static double median(QList<double> values)
+{
+    if (values.isEmpty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// share of the run the allocator, caches and glyphs get to reach their
+// steady state before memory and latency are compared
+static constexpr double soakWarmup = 0.2;
+
+// growth from the first to the last quarter of the measured run that fails
+static constexpr qint64 maxResidentGrowth = 8 << 20;
+static constexpr qint64 maxHeapGrowth = 2 << 20;
+
+// the median render time may grow by this factor plus the slack in us
+static constexpr double maxLatencyDrift = 1.5;
+static constexpr double latencySlack = 100;
+
+// runs the shown settings window for the given time and randomly moves
+// the sliders, clicks the checkboxes, pastes random codes, cycles the
+// screen, adds and removes layers and resets, like a long session of
+// tweaking. every change saves into a temporary ini file. samples the
+// resident memory, the heap and the render time at regular intervals and
+// fails if memory or the median render time of the last quarter of the
+// run grew past the limits against the first quarter after the warmup.
+// returns the process exit code
+int soak(double seconds)
+{
+    QTextStream out(stdout);
+
+    QTemporaryDir dir;
+    if (!dir.isValid())
+    {
+        out << "FAIL: no temporary directory for the config\n";
+        return 1;
+    }
+
+    Config conf;
+    conf.firstTime = false;
+
+    MainWindow window(conf);
+    ConfigModel &model = window.configModel();
+    model.setStorage(dir.filePath("config.ini"));
+
+    window.setup();
+    window.show();
+
+    QRandomGenerator rng(42);
+
+    const char *sliders[] = {"i_length",       "i_thickness",   "i_gap",         "i_dotSize",
+                             "i_shadowradius", "i_shadowalpha", "i_outlinewidth"};
+    const char *checkBoxes[] = {"i_dotEnabled", "i_shadow", "i_outline"};
+
+    QComboBox *layer = child<QComboBox>(window, "i_layer");
+
+    struct Action
+    {
+        QString name;
+        std::function<void()> run;
+        qint64 count = 0;
+    };
+
+    QList<Action> actions = {
+        {"slider",
+         [&]() {
+             QSlider *slider = child<QSlider>(window, sliders[rng.bounded(int(std::size(sliders)))]);
+             slider->setValue(rng.bounded(slider->minimum(), slider->maximum() + 1));
+         }},
+        {"checkbox", [&]() { child<QCheckBox>(window, checkBoxes[rng.bounded(int(std::size(checkBoxes)))])->click(); }},
+        {"paste code",
+         [&]() {
+             emit child<QLineEdit>(window, "i_crosshairCode")->textEdited(ccode::generateCode(randomConfig(rng)));
+         }},
+        {"cycle screen", [&]() { child<QPushButton>(window, "i_cycleScreen")->click(); }},
+        // the layer count stays bounded, more layers are more memory on purpose
+        {"layer",
+         [&]() {
+             const bool add = layer->count() < 2 || (layer->count() < 4 && rng.bounded(2) == 1);
+             if (!add)
+                 layer->setCurrentIndex(rng.bounded(1, layer->count()));
+             child<QPushButton>(window, add ? "i_addLayer" : "i_removeLayer")->click();
+         }},
+        {"select layer", [&]() { layer->setCurrentIndex(rng.bounded(layer->count())); }},
+        {"reset", [&]() { child<QPushButton>(window, "i_resetConf")->click(); }},
+    };
+
+    // sliders and codes are what people change most, resets the least
+    const int weights[] = {8, 3, 4, 1, 1, 2, 1};
+    const int totalWeight = std::accumulate(std::begin(weights), std::end(weights), 0);
+
+    struct Sample
+    {
+        double time;
+        qint64 resident;
+        HeapUsage heap;
+        double render;
+    };
+
+    // about 60 samples per run, between 0.1 and 10 s apart
+    const qint64 duration = qint64(seconds * 1e9);
+    const qint64 interval = std::clamp<qint64>(duration / 60, 100000000, 10000000000);
+
+    QList<Sample> samples;
+    QList<double> renders;
+    qint64 steps = 0;
+
+    const qint64 heapBefore = heap::allocations();
+    const qint64 buffersBefore = pixel::allocations();
+    const qint64 savesBefore = model.saves();
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 next = interval;
+
+    while (clock.nsecsElapsed() < duration)
+    {
+        int pick = rng.bounded(totalWeight);
+        int i = 0;
+        while (pick >= weights[i])
+            pick -= weights[i++];
+
+        const qint64 renderCount = window.renderCount();
+        actions[i].run();
+        ++actions[i].count;
+        ++steps;
+
+        // lets the overlay paint and runs deferred deletes, like the event loop would
+        QCoreApplication::processEvents();
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+        if (window.renderCount() != renderCount)
+            renders.append(window.renderTime() / 1e3);
+
+        if (clock.nsecsElapsed() < next)
+            continue;
+
+        const Sample sample = {clock.nsecsElapsed() / 1e9, residentSize(), heapUsage(), median(renders)};
+        samples.append(sample);
+        renders.clear();
+        next += interval;
+
+        out << QString("%1 s: %2 KiB resident, %3 KiB heap used, %4 KiB heap free, render %5 us, %6 steps\n")
+                   .arg(sample.time, 0, 'f', 1)
+                   .arg(sample.resident / 1024)
+                   .arg(sample.heap.used / 1024)
+                   .arg(sample.heap.free / 1024)
+                   .arg(sample.render, 0, 'f', 1)
+                   .arg(steps);
+    }
+
+    QStringList counts;
+    for (const Action &action : actions)
+        counts << QString("%1 %2").arg(action.count).arg(action.name);
+
+    out << QString("%1 steps (%2), %3 saves, %4 operator new, %5 pixel buffers\n")
+               .arg(steps)
+               .arg(counts.join(", "))
+               .arg(model.saves() - savesBefore)
+               .arg(heap::allocations() - heapBefore)
+               .arg(pixel::allocations() - buffersBefore);
+
+    // the samples after the warmup, compared by the medians of their first and last quarter
+    QList<Sample> measured;
+    for (const Sample &sample : samples)
+        if (sample.time >= seconds * soakWarmup)
+            measured.append(sample);
+
+    if (measured.size() < 8)
+    {
+        out << QString("FAIL: %1 samples after the warmup, run longer\n").arg(measured.size());
+        return 1;
+    }
+
+    const int quarter = int(measured.size()) / 4;
+    auto compare = [&](const std::function<double(const Sample &)> &value) {
+        QList<double> first, last;
+        for (int i = 0; i < quarter; ++i)
+        {
+            first.append(value(measured[i]));
+            last.append(value(measured[measured.size() - quarter + i]));
+        }
+        return std::make_pair(median(first), median(last));
+    };
+
+    int failures = 0;
+
+    auto checkGrowth = [&](const QString &name, bool known, double from, double to, double limit) {
+        const bool ok = to - from <= limit;
+        if (known && !ok)
+            ++failures;
+
+        if (!known)
+            out << QString("INFO %1: not available on this platform\n").arg(name);
+        else
+            out << QString("%1 %2: %3 KiB to %4 KiB (limit +%5 KiB)\n")
+                       .arg(ok ? "PASS" : "FAIL")
+                       .arg(name)
+                       .arg(qint64(from) / 1024)
+                       .arg(qint64(to) / 1024)
+                       .arg(qint64(limit) / 1024);
+    };
+
+    const auto resident = compare([](const Sample &s) { return double(s.resident); });
+    checkGrowth("resident memory", measured.first().resident >= 0, resident.first, resident.second,
+                maxResidentGrowth);
+
+    const auto used = compare([](const Sample &s) { return double(s.heap.used); });
+    checkGrowth("heap used", measured.first().heap.used >= 0, used.first, used.second, maxHeapGrowth);
+
+    // fragmentation is reported only, glibc keeps freed memory around on purpose
+    if (measured.first().heap.free >= 0)
+    {
+        const auto spare = compare([](const Sample &s) { return double(s.heap.free); });
+        out << QString("INFO heap free: %1 KiB to %2 KiB\n")
+                   .arg(qint64(spare.first) / 1024)
+                   .arg(qint64(spare.second) / 1024);
+    }
+
+    const auto render = compare([](const Sample &s) { return s.render; });
+    const double latencyLimit = render.first * maxLatencyDrift + latencySlack;
+    const bool latencyOk = render.second <= latencyLimit;
+    if (!latencyOk)
+        ++failures;
+
+    out << QString("%1 render time: %2 us to %3 us (limit %4 us)\n")
+               .arg(latencyOk ? "PASS" : "FAIL")
+               .arg(render.first, 0, 'f', 1)
+               .arg(render.second, 0, 'f', 1)
+               .arg(latencyLimit, 0, 'f', 1);
+
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace diag
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <QImage>
+#include <QString>
+
+namespace diag
+{
+
+int checkRender(const QString &diffDir);
+
+int checkIdle(double seconds);
+
+int checkContrast();
+
+int benchRender();
+
+int checkAlloc();
+
+int checkModel();
+
+int checkControl();
+
+int benchLatency(int samples);
+
+int checkSparse();
+
+int benchSimilar(int count);
+
+int soak(double seconds);
+
+} // namespace diag
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "diag.h"
+#include <QApplication>
+#include <QCommandLineParser>
+
+// entry point of the diagnostics, a separate executable next to the app.
+// every mode runs one check or benchmark and returns its result as the exit
+// code, ctest runs them (see CMakeLists.txt). they run headless on the
+// offscreen platform unless another one was picked explicitly
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    QCommandLineOption checkRenderOption("check-render", "Compare the renderer against the reference renderer.");
+    QCommandLineOption diffDirOption("diff-dir", "Directory --check-render writes images of failed cases to.", "dir",
+                                     "render-diff");
+
+    QCommandLineOption checkIdleOption("check-idle", "Check that the hidden app does not wake up while idle.");
+    QCommandLineOption durationOption("duration", "Seconds --check-idle runs.", "s", "5");
+    QCommandLineOption checkContrastOption("check-contrast",
+                                          "Check the adaptive color decision on synthetic backgrounds.");
+    QCommandLineOption benchRenderOption("bench-render", "Time plain, shadow and outline renders.");
+    QCommandLineOption checkAllocOption("check-alloc",
+                                        "Check that dragging the sliders does not allocate while rendering.");
+    QCommandLineOption checkModelOption("check-model",
+                                        "Check that every settings change renders and saves exactly once.");
+    QCommandLineOption checkControlOption("check-control",
+                                          "Check the seqlock of the control block under concurrent writes and that "
+                                          "driven fields only override the render.");
+    QCommandLineOption benchLatencyOption("bench-latency",
+                                          "Time settings changes from the input event to the overlay paint and "
+                                          "print json.");
+    QCommandLineOption samplesOption("samples", "Samples per action of --bench-latency.", "n", "200");
+    QCommandLineOption checkSparseOption("check-sparse",
+                                         "Check that span encoded crosshair images are lossless and report their "
+                                         "size.");
+    QCommandLineOption benchSimilarOption("bench-similar", "Time nearest preset queries over random presets.");
+    QCommandLineOption presetsOption("presets", "Presets --bench-similar searches.", "n", "100000");
+    QCommandLineOption soakOption("soak",
+                                  "Randomly change and save settings for the given seconds and check that memory "
+                                  "and render time stay flat.",
+                                  "s");
+
+    parser.addOptions({checkRenderOption, diffDirOption, checkIdleOption, durationOption, checkContrastOption,
+                       benchRenderOption, checkAllocOption, checkModelOption, checkControlOption, benchLatencyOption,
+                       samplesOption, checkSparseOption, benchSimilarOption, presetsOption, soakOption});
+    parser.process(app);
+
+    if (parser.isSet(checkRenderOption))
+    {
+        return diag::checkRender(parser.value(diffDirOption));
+    }
+
+    if (parser.isSet(checkIdleOption))
+    {
+        return diag::checkIdle(parser.value(durationOption).toDouble());
+    }
+
+    if (parser.isSet(checkContrastOption))
+    {
+        return diag::checkContrast();
+    }
+
+    if (parser.isSet(benchRenderOption))
+    {
+        return diag::benchRender();
+    }
+
+    if (parser.isSet(checkAllocOption))
+    {
+        return diag::checkAlloc();
+    }
+
+    if (parser.isSet(checkModelOption))
+    {
+        return diag::checkModel();
+    }
+
+    if (parser.isSet(checkControlOption))
+    {
+        return diag::checkControl();
+    }
+
+    if (parser.isSet(benchLatencyOption))
+    {
+        return diag::benchLatency(qMax(1, parser.value(samplesOption).toInt()));
+    }
+
+    if (parser.isSet(checkSparseOption))
+    {
+        return diag::checkSparse();
+    }
+
+    if (parser.isSet(benchSimilarOption))
+    {
+        return diag::benchSimilar(qMax(1, parser.value(presetsOption).toInt()));
+    }
+
+    if (parser.isSet(soakOption))
+    {
+        return diag::soak(parser.value(soakOption).toDouble());
+    }
+
+    parser.showHelp(1);
+}
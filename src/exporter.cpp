@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "exporter.h"
+
+#include "ccode.h"
+#include "config.h"
+#include "crosshair.h"
+#include "sparse.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThreadPool>
+#include <memory>
+#include <vector>
+
+namespace exporter
+{
+
+// codes rendered in parallel per thread before the results are written,
+// this keeps memory bounded no matter how long the input is
+static constexpr int batchPerThread = 16;
+
+// transparent pixels between sprites on a sheet
+static constexpr int spacing = 1;
+
+// one rendered code, kept as the runs of its visible pixels until
+// it is packed, which is a fraction of the dense image
+struct Sprite
+{
+    qint64 line = 0;
+    QString code;
+    bool valid = false;
+    sparse::Image image;
+
+    // the visible pixels in the image, at least one pixel
+    QRect box;
+
+    // position of the crosshair center inside of box
+    QPoint pivot;
+
+    // the file that couldn't be written in single file mode, if any
+    QString failedPath;
+};
+
+static QString spriteName(qint64 line, bool snapshot)
+{
+    return QString("%1.%2").arg(line, 6, 10, QChar('0')).arg(snapshot ? "chs" : "png");
+}
+
+// renders a sprite, runs on the pool threads. every thread keeps its own
+// layer cache, so codes sharing geometry or shadow settings skip those stages.
+// in single file mode the png or snapshot is written right here, in parallel
+static void renderSprite(Sprite &sprite, const QDir &dir, bool save, bool snapshot)
+{
+    Config opt;
+    if (!ccode::applyCode(sprite.code, opt))
+        return;
+    opt.clamp();
+
+    thread_local Crosshair::Layers layers;
+    const QImage &image = Crosshair::renderImage(opt, layers);
+
+    sparse::encode(image, layers.compositeRect, sprite.image);
+
+    QRect box = sprite.image.rect();
+    if (box.isEmpty())
+        box = QRect(image.width() / 2, image.height() / 2, 1, 1);
+
+    sprite.box = box;
+    sprite.pivot = QPoint(image.width() / 2, image.height() / 2) - box.topLeft();
+    sprite.valid = true;
+
+    if (save)
+    {
+        const QString path = dir.filePath(spriteName(sprite.line, snapshot));
+
+        bool written = false;
+        if (snapshot)
+        {
+            QFile file(path);
+            written = file.open(QIODevice::WriteOnly | QIODevice::Truncate) && sparse::write(sprite.image, file);
+        }
+        else
+        {
+            written = image.copy(box).save(path);
+        }
+
+        if (!written)
+            sprite.failedPath = path;
+
+        sprite.image = sparse::Image();
+    }
+}
+
+// shelf packer, fills fixed size sheets row by row and writes every sheet to
+// disk as soon as it is full, so only one sheet is kept in memory. the atlas
+// is streamed out entry by entry for the same reason
+class SheetWriter
+{
+  public:
+    SheetWriter(const QDir &dir, int size, QTextStream &atlas, QTextStream &err)
+        : m_dir(dir), m_size(size), m_atlas(atlas), m_err(err)
+    {
+        m_atlas << "{\n  \"sprites\": [\n";
+    }
+
+    void add(const Sprite &sprite)
+    {
+        const int w = sprite.box.width();
+        const int h = sprite.box.height();
+
+        if (m_sheet.isNull())
+            startSheet();
+
+        // next shelf
+        if (m_x + w > m_size)
+        {
+            m_x = 0;
+            m_y += m_rowHeight + spacing;
+            m_rowHeight = 0;
+        }
+
+        // next sheet
+        if (m_y + h > m_size)
+        {
+            flush();
+            startSheet();
+        }
+
+        // the sheet is transparent, so blending the runs just copies them
+        sparse::blit(sprite.image, m_sheet, QPoint(m_x, m_y) - sprite.box.topLeft(), QRect(m_x, m_y, w, h));
+
+        QJsonObject entry;
+        entry["line"] = sprite.line;
+        entry["code"] = sprite.code;
+        entry["sheet"] = sheetName();
+        entry["x"] = m_x;
+        entry["y"] = m_y;
+        entry["w"] = w;
+        entry["h"] = h;
+        entry["pivotX"] = sprite.pivot.x();
+        entry["pivotY"] = sprite.pivot.y();
+
+        m_atlas << (m_entries++ ? ",\n    " : "    ") << QJsonDocument(entry).toJson(QJsonDocument::Compact);
+
+        m_x += w + spacing;
+        m_rowHeight = qMax(m_rowHeight, h);
+    }
+
+    void finish()
+    {
+        flush();
+        m_atlas << "\n  ]\n}\n";
+        m_atlas.flush();
+    }
+
+    // sheets that couldn't be written
+    int failures() const
+    {
+        return m_failures;
+    }
+
+  private:
+    QString sheetName() const
+    {
+        return QString("sheet-%1.png").arg(m_index);
+    }
+
+    void startSheet()
+    {
+        ++m_index;
+        m_sheet = QImage(m_size, m_size, QImage::Format_ARGB32_Premultiplied);
+        m_sheet.fill(Qt::transparent);
+        m_x = 0;
+        m_y = 0;
+        m_rowHeight = 0;
+    }
+
+    // writes the sheet, cropped to the rows actually used
+    void flush()
+    {
+        if (m_sheet.isNull())
+            return;
+
+        const QString path = m_dir.filePath(sheetName());
+        if (!m_sheet.copy(0, 0, m_size, qMin(m_size, m_y + m_rowHeight)).save(path))
+        {
+            ++m_failures;
+            m_err << QString("cannot write %1\n").arg(path);
+        }
+        m_sheet = QImage();
+    }
+
+    QDir m_dir;
+    int m_size;
+    QTextStream &m_atlas;
+    QTextStream &m_err;
+
+    QImage m_sheet;
+    int m_index = -1;
+    int m_x = 0;
+    int m_y = 0;
+    int m_rowHeight = 0;
+    qint64 m_entries = 0;
+    int m_failures = 0;
+};
+
+// reads crosshair codes line by line (empty lines and # comments are
+// skipped), renders them in batches on a thread pool and writes single pngs
+// (or snapshots) or sprite sheets plus atlas.json into the output directory.
+// prints the throughput when done and returns the process exit code,
+// which is 1 if any code was invalid or any file couldn't be written
+int run(const Options &opt)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QFile input(opt.input);
+    const bool opened = opt.input == "-" ? input.open(stdin, QIODevice::ReadOnly | QIODevice::Text)
+                                         : input.open(QIODevice::ReadOnly | QIODevice::Text);
+    if (!opened)
+    {
+        err << QString("cannot open %1\n").arg(opt.input);
+        return 1;
+    }
+
+    QDir dir(opt.outputDir);
+    if (!dir.mkpath("."))
+    {
+        err << QString("cannot create %1\n").arg(opt.outputDir);
+        return 1;
+    }
+
+    QFile atlasFile(dir.filePath("atlas.json"));
+    QTextStream atlas;
+    std::unique_ptr<SheetWriter> sheets;
+
+    if (opt.sheets)
+    {
+        if (!atlasFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        {
+            err << QString("cannot write %1\n").arg(atlasFile.fileName());
+            return 1;
+        }
+
+        // the largest crosshair with shadow has to fit on a sheet
+        atlas.setDevice(&atlasFile);
+        sheets = std::make_unique<SheetWriter>(dir, qMax(opt.sheetSize, 512), atlas, err);
+    }
+
+    QThreadPool pool;
+    if (opt.threads > 0)
+        pool.setMaxThreadCount(opt.threads);
+
+    const size_t batchSize = size_t(pool.maxThreadCount()) * batchPerThread;
+
+    std::vector<Sprite> batch;
+    batch.reserve(batchSize);
+
+    qint64 lineNumber = 0;
+    qint64 rendered = 0;
+    qint64 invalid = 0;
+    qint64 failed = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // render the current batch in parallel, then write it out in input order
+    auto process = [&]() {
+        for (Sprite &sprite : batch)
+            pool.start([&sprite, &dir, &opt]() { renderSprite(sprite, dir, !opt.sheets, opt.snapshots); });
+        pool.waitForDone();
+
+        for (const Sprite &sprite : batch)
+        {
+            if (!sprite.valid)
+            {
+                ++invalid;
+                err << QString("line %1: invalid crosshair code\n").arg(sprite.line);
+                continue;
+            }
+
+            if (!sprite.failedPath.isEmpty())
+            {
+                ++failed;
+                err << QString("line %1: cannot write %2\n").arg(sprite.line).arg(sprite.failedPath);
+                continue;
+            }
+
+            ++rendered;
+            if (sheets)
+                sheets->add(sprite);
+        }
+
+        batch.clear();
+    };
+
+    QTextStream in(&input);
+    QString line;
+
+    while (in.readLineInto(&line))
+    {
+        ++lineNumber;
+
+        const QString code = line.trimmed();
+        if (code.isEmpty() || code.startsWith('#'))
+            continue;
+
+        Sprite sprite;
+        sprite.line = lineNumber;
+        sprite.code = code;
+        batch.push_back(std::move(sprite));
+
+        if (batch.size() >= batchSize)
+            process();
+    }
+
+    process();
+
+    if (sheets)
+    {
+        sheets->finish();
+        failed += sheets->failures();
+
+        if (atlas.status() != QTextStream::Ok)
+        {
+            ++failed;
+            err << QString("cannot write %1\n").arg(atlasFile.fileName());
+        }
+    }
+
+    err.flush();
+
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    out << QString("%1 codes exported in %2 s (%3 codes/sec, %4 threads), %5 invalid, %6 failed writes\n")
+               .arg(rendered)
+               .arg(seconds, 0, 'f', 3)
+               .arg(seconds > 0 ? rendered / seconds : 0.0, 0, 'f', 1)
+               .arg(pool.maxThreadCount())
+               .arg(invalid)
+               .arg(failed);
+
+    return invalid == 0 && failed == 0 ? 0 : 1;
+}
+
+} // namespace exporter
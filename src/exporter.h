@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include <QString>
+
+namespace exporter
+{
+
+// settings of a batch export, filled from the command line
+struct Options
+{
+    // file with one crosshair code per line, "-" reads stdin
+    QString input = "-";
+    QString outputDir = "export";
+
+    // pack the crosshairs into sprite sheets with a json atlas
+    // instead of writing one png per code
+    bool sheets = false;
+    int sheetSize = 2048;
+
+    // write span encoded snapshots (.chs, see sparse::write)
+    // instead of pngs when not packing sheets
+    bool snapshots = false;
+
+    // render threads, 0 uses one per core
+    int threads = 0;
+};
+
+int run(const Options &opt);
+
+} // namespace exporter
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "heap.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// counts the heap allocations of the process, to check that the render
+// path doesn't allocate. with glibc malloc, calloc and realloc themselves
+// are replaced, which also catches what Qt allocates with them (QString,
+// QList and QByteArray data, QImage pixels). elsewhere only operator new is
+// counted, and with dll builds (Windows) only the allocations made from
+// this executable are seen, not the ones inside of Qt.
+// only the diagnostics are linked with this, never the app
+static std::atomic<qint64> counter{0};
+
+#if defined(__GLIBC__)
+
+// the allocator behind the replaced functions
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t count, std::size_t size);
+extern "C" void *__libc_realloc(void *p, std::size_t size);
+extern "C" void __libc_free(void *p);
+
+extern "C" void *malloc(std::size_t size) noexcept
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(std::size_t count, std::size_t size) noexcept
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+// a realloc counts even if the block could grow in place
+extern "C" void *realloc(void *p, std::size_t size) noexcept
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void *p) noexcept
+{
+    __libc_free(p);
+}
+
+// operator new is counted by the malloc it calls
+static constexpr bool countsMalloc = true;
+
+#else
+
+static constexpr bool countsMalloc = false;
+
+#endif
+
+static void *allocate(std::size_t size)
+{
+    if (!countsMalloc)
+        counter.fetch_add(1, std::memory_order_relaxed);
+
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace heap
+{
+
+// heap allocations since startup
+qint64 allocations()
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+// true if allocations() also counts malloc and everything Qt allocates
+bool coversMalloc()
+{
+    return countsMalloc;
+}
+
+} // namespace heap
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include <QtGlobal>
+
+namespace heap
+{
+
+qint64 allocations();
+
+bool coversMalloc();
+
+} // namespace heap
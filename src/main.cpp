@@ -7,9 +7,14 @@
  */
 
 #include "config.h"
+#include "control.h"
+#include "exporter.h"
 #include "mainwindow.h"
+#include "stats.h"
 #include "util.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include <QFile>
 #include <QFont>
 #include <QFontDatabase>
@@ -37,26 +42,90 @@ void registerSignalHandlers()
     signal(SIGTERM, handleSignal);
 }
 
-// this function creates a shared memory to probe for
-// other instances of this app running
-bool alreadyRunning()
+// this function creates the shared control block, which is
+// also how other instances of this app running are detected
+bool alreadyRunning(QSharedMemory &shared)
 {
-    QSharedMemory shared("crosshairpp.sharedmem");
     gShared = &shared;
-    if (!shared.create(1))
+    if (!control::create(shared))
     {
         return true;
     }
     return false;
 }
 
+// the headless modes don't need a display, so default them to the
+// offscreen platform unless the user picked one explicitly
+void selectHeadlessPlatform(int argc, char *argv[])
+{
+    const QByteArrayList headlessOptions = {"--export", "--drive"};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (headlessOptions.contains(QByteArray(argv[i])) && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+            return;
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     registerSignalHandlers();
+    selectHeadlessPlatform(argc, argv);
 
     QApplication app(argc, argv);
 
-    if (alreadyRunning())
+    // command line options. export and drive run headless
+    // (e.g. with -platform offscreen) and exit when done
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    QCommandLineOption durationOption("duration", "Seconds --drive runs.", "s", "5");
+    QCommandLineOption statsOption("stats",
+                                   "Count event loop wakeups, timers and overlay paints, reported from the tray.");
+
+    QCommandLineOption exportOption("export", "Render crosshair codes from a file (- for stdin) to png and exit.",
+                                    "file");
+    QCommandLineOption outputOption("output", "Output directory of --export.", "dir", "export");
+    QCommandLineOption sheetsOption("sheets", "Pack exported crosshairs into sprite sheets with a json atlas.");
+    QCommandLineOption snapshotsOption("snapshots", "Export span encoded .chs snapshots instead of pngs.");
+    QCommandLineOption sheetSizeOption("sheet-size", "Width and height of a sprite sheet.", "px", "2048");
+    QCommandLineOption threadsOption("threads", "Render threads of --export, 0 uses one per core.", "n", "0");
+    QCommandLineOption controlOption("control",
+                                     "Apply what other processes write into the shared control block every frame.");
+    QCommandLineOption driveOption("drive",
+                                   "Drive the control block of the running app at a rate per second (0 as fast as "
+                                   "possible) for --duration seconds and exit.",
+                                   "rate");
+    QCommandLineOption watchOption("watch", "Apply the settings of an ini profile and reload it whenever it changes.",
+                                   "file");
+
+    parser.addOptions({durationOption, statsOption, exportOption, outputOption, sheetsOption, snapshotsOption,
+                       sheetSizeOption, threadsOption, controlOption, driveOption, watchOption});
+    parser.process(app);
+
+    if (parser.isSet(exportOption))
+    {
+        exporter::Options opt;
+        opt.input = parser.value(exportOption);
+        opt.outputDir = parser.value(outputOption);
+        opt.sheets = parser.isSet(sheetsOption);
+        opt.sheetSize = parser.value(sheetSizeOption).toInt();
+        opt.snapshots = parser.isSet(snapshotsOption);
+        opt.threads = parser.value(threadsOption).toInt();
+
+        return exporter::run(opt);
+    }
+
+    if (parser.isSet(driveOption))
+    {
+        return control::drive(parser.value(driveOption).toDouble(), parser.value(durationOption).toDouble());
+    }
+
+    QSharedMemory shared;
+    if (alreadyRunning(shared))
     {
         QMessageBox::warning(nullptr, "Already running",
                              "Crosshair++ is already running. Check your system tray to open the settings.");
@@ -77,8 +146,31 @@ int main(int argc, char *argv[])
     MainWindow window(conf);
     window.setup();
 
+    EventStats stats;
+    if (parser.isSet(statsOption))
+    {
+        stats.start();
+        window.enableStats(&stats);
+    }
+
+    if (parser.isSet(watchOption))
+    {
+        window.watchConfig(parser.value(watchOption));
+    }
+
+    if (parser.isSet(controlOption))
+    {
+        window.enableControl(static_cast<const control::Block *>(shared.constData()));
+    }
+
     window.show();
 
     app.exec();
+
+    if (parser.isSet(statsOption))
+    {
+        qInfo().noquote() << stats.report();
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -17,6 +17,11 @@
 #include <QCheckBox>
 #include <QCloseEvent>
 #include <QColorDialog>
+#include <QComboBox>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileDialog>
 #include <QLineEdit>
 #include <QMenu>
 #include <QMessageBox>
@@ -24,10 +29,18 @@
 #include <QSettings>
 #include <QStyle>
 #include <QSystemTrayIcon>
+#include <QTextStream>
 #include <QWidget>
 
+// presets listed by the similar presets button
+static constexpr int similarPresets = 8;
+
+// presets closer than this look the same
+static constexpr float duplicateDistance = 0.005f;
+
 // main window constructor
-MainWindow::MainWindow(Config &cfg) : QWidget(), m_config(cfg), crosshairRenderer(m_config)
+MainWindow::MainWindow(Config &cfg)
+    : QWidget(), m_config(cfg), model(m_config), crosshairRenderer(m_config), contrastSampler(m_config, layers)
 {
     // this loads the ui compiled by uic
     ui.setupUi(this);
@@ -40,7 +53,7 @@ MainWindow::MainWindow(Config &cfg) : QWidget(), m_config(cfg), crosshairRendere
 void MainWindow::setup()
 {
     // sets all the ui components to the settings
-    m_config.showConfig(ui);
+    showConfig();
 
     // if the program is started for the first time,
     // show a nice welcome dialogue
@@ -48,8 +61,7 @@ void MainWindow::setup()
     {
         util::welcomeDialogue();
 
-        m_config.firstTime = false;
-        m_config.saveConfig();
+        model.change([](Config &cfg) { cfg.firstTime = false; });
     }
 
     // add tray and the connections for quitting
@@ -153,149 +165,418 @@ void MainWindow::setupTrayConnections()
 // you want to call this after changing settings
 void MainWindow::render()
 {
-    // render the crosshair
-    crosshairRenderer.label->setPixmap(Crosshair::render(m_config));
-
-    // show only if enabled
-    if (m_config.enabled)
+    ++renders;
+    lastRenderTime = 0;
+    renderedConfig = m_config;
+
+    // starts or stops the adaptive color sampling
+    contrastSampler.update();
+
+    // the adaptive mode may swap in its second color, which
+    // only re-runs the composite pass of the cached layers.
+    // fields driven through the control block win over both
+    Config opt = m_config;
+    opt.color = contrastSampler.activeColor();
+    if (controlReader)
+        controlReader->apply(opt);
+    renderedOpt = opt;
+
+    // a disabled crosshair isn't rendered at all, it
+    // is brought up to date once it gets enabled again
+    if (!opt.enabled)
     {
-        crosshairRenderer.show();
+        crosshairRenderer.hide();
+        return;
     }
-    else
+
+    // render the crosshair, but only repaint the overlay if the image
+    // actually changed. the overlay keeps just the runs of non transparent
+    // pixels of it, encoded into the same buffers every time
+    QElapsedTimer timer;
+    timer.start();
+    const QImage &image = Crosshair::renderImage(opt, layers);
+    lastRenderTime = timer.nsecsElapsed();
+
+    if (layers.serial != shownSerial)
     {
-        crosshairRenderer.hide();
+        sparse::encode(image, layers.compositeRect, shownImage);
+        crosshairRenderer.setImage(&shownImage);
+        shownSerial = layers.serial;
     }
+
+    crosshairRenderer.show();
 }
 
 // this function refreshes the shown crossharCode
 // and also renders and displays the crosshair again
 void MainWindow::updateUi()
 {
-    QString crosshairCode = ccode::generateCode(m_config);
-    ui.i_crosshairCode->setText(crosshairCode);
+    showCode();
     render();
 }
 
-// logic for all the buttons. the changes on the crosshair options get written to settings,
-// and a save is triggered. also links sliders to their matching QSpinBox to ensure sync.
+// the code isn't replaced while the user is typing one
+void MainWindow::showCode()
+{
+    lastCodeTime = 0;
+    if (!ui.i_crosshairCode->hasFocus())
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QString crosshairCode = ccode::generateCode(m_config);
+        lastCodeTime = timer.nsecsElapsed();
+
+        ui.i_crosshairCode->setText(crosshairCode);
+    }
+}
+
+// applies the profile file at path, which is written by external tools
+// (e.g. game launchers) and keeps reloading it whenever it changes
+void MainWindow::watchConfig(const QString &path)
+{
+    // the watcher applies the profile once on creation, the model
+    // shows it like any other change
+    configWatcher = new ConfigWatcher(model, path, this);
+}
+
+// lets other processes drive the crosshair through the shared control
+// block. it is read every frame, so this keeps the app awake
+void MainWindow::enableControl(const control::Block *block)
+{
+    controlReader = new ControlReader(m_config, block, this);
+    connect(controlReader, &ControlReader::changed, this, &MainWindow::render);
+}
+
+// adds a tray entry that reports the event loop statistics
+void MainWindow::enableStats(EventStats *stats)
+{
+    QAction *statsAction = new QAction("Statistics", this);
+    trayMenu->insertAction(quitAction, statsAction);
+
+    connect(statsAction, &QAction::triggered, this, [this, stats]() {
+        QString report = stats->report() + "\n" + model.report() + "\n" + contrastSampler.report();
+        report += QString("\noverlay image: %1 bytes as runs, %2 bytes dense")
+                      .arg(shownImage.bytes())
+                      .arg(qint64(shownImage.size.width()) * shownImage.size.height() * 4);
+        if (configWatcher)
+            report += "\n" + configWatcher->report();
+        if (controlReader)
+            report += "\n" + controlReader->report();
+        qInfo().noquote() << report;
+        QMessageBox::information(nullptr, "Statistics", report);
+    });
+}
+
+ConfigModel &MainWindow::configModel()
+{
+    return model;
+}
+
+// how often the crosshair was rendered, for checking that
+// one change of the settings renders exactly once
+qint64 MainWindow::renderCount() const
+{
+    return renders;
+}
+
+const Config &MainWindow::renderedOptions() const
+{
+    return renderedOpt;
+}
+
+qint64 MainWindow::codeTime() const
+{
+    return lastCodeTime;
+}
+
+qint64 MainWindow::renderTime() const
+{
+    return lastRenderTime;
+}
+
+// opens a color dialog for the color target returns with a live preview
+// while picking, a color change only re-runs the composite pass of the
+// cached layers. the previews aren't saved, only the color the dialog
+// closes with is. target is asked again for every change, since a color
+// of an extra layer lives in a list that may be copied meanwhile
+void MainWindow::pickColor(const std::function<QColor &(Config &)> &target, const QString &title)
+{
+    const QColor previous = target(m_config);
+
+    QColorDialog dialog(previous, this);
+    dialog.setWindowTitle(title);
+
+    connect(&dialog, &QColorDialog::currentColorChanged, this, [this, &target](const QColor &color) {
+        model.change([&](Config &cfg) { target(cfg) = color; }, ConfigModel::Preview);
+    });
+
+    // restore the previous color if the dialog was canceled
+    const QColor color = dialog.exec() == QDialog::Accepted ? dialog.selectedColor() : previous;
+    model.change([&](Config &cfg) { target(cfg) = color; });
+}
+
+// shows the config in the settings, the crosshair widgets
+// show the layer that is currently selected
+void MainWindow::showConfig()
+{
+    currentLayer = qMin(currentLayer, int(m_config.extraLayers.size()));
+    m_config.showConfig(ui, currentLayer);
+}
+
+// applies edit to the options of the currently selected layer
+void MainWindow::editLayer(Config &cfg, const std::function<void(Config::Layer &)> &edit)
+{
+    Config::Layer layer = cfg.layer(currentLayer);
+    edit(layer);
+    cfg.setLayer(currentLayer, layer);
+}
+
+// the color of the currently selected layer
+QColor &MainWindow::layerColor(Config &cfg)
+{
+    return currentLayer == 0 ? cfg.color : cfg.extraLayers[currentLayer - 1].color;
+}
+
+// true if both configs put the same crosshair on the same screen
+static bool sameLook(const Config &a, const Config &b)
+{
+    return Crosshair::sameRender(a, b) && a.enabled == b.enabled && a.currentScreenIndex == b.currentScreenIndex &&
+           a.adaptive == b.adaptive && a.adaptiveColor == b.adaptiveColor && a.adaptiveRate == b.adaptiveRate;
+}
+
+// shows a config that changed, either through the model or outside
+// of the settings window. the widgets are updated with their signals
+// blocked, and the crosshair is rendered once. options without a visible
+// effect (e.g. the shadow radius while the shadow is off) only show up
+// in the widgets and the code
+void MainWindow::showChanges()
+{
+    showConfig();
+
+    if (sameLook(renderedConfig, m_config))
+    {
+        showCode();
+        return;
+    }
+
+    updateUi();
+    crosshairRenderer.update();
+}
+
+// binds a slider and its QSpinBox to an option. the spinbox only moves
+// the slider, so a change of either ends up as a single commit
+void MainWindow::bindSlider(QSlider *slider, QSpinBox *spinBox, const std::function<void(Config &, int)> &set)
+{
+    connect(slider, &QSlider::valueChanged, this,
+            [this, set](int value) { model.change([&](Config &cfg) { set(cfg, value); }); });
+
+    connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), slider, &QSlider::setValue);
+}
+
+void MainWindow::bindCheckBox(QCheckBox *checkBox, const std::function<void(Config &, bool)> &set)
+{
+    connect(checkBox, &QCheckBox::toggled, this,
+            [this, set](bool value) { model.change([&](Config &cfg) { set(cfg, value); }); });
+}
+
+// loads the presets file into the similarity index, the first time asking
+// for the file (an existing one, or with create also a new one). the path is
+// remembered in the settings. returns false if there is no presets file
+bool MainWindow::openPresets(bool create)
+{
+    if (!presetsPath.isEmpty())
+        return true;
+
+    QSettings settings("Crosshair++", "config");
+    QString path = settings.value("presets/file").toString();
+
+    if (path.isEmpty() || !QFile::exists(path))
+    {
+        const QString filter = "Crosshair codes (*.txt);;All files (*)";
+        path = create ? QFileDialog::getSaveFileName(this, "Presets File", QString(), filter, nullptr,
+                                                     QFileDialog::DontConfirmOverwrite)
+                      : QFileDialog::getOpenFileName(this, "Presets File", QString(), filter);
+        if (path.isEmpty())
+            return false;
+
+        settings.setValue("presets/file", path);
+    }
+
+    // a new file doesn't exist yet, it starts out empty
+    if (!presets.load(path) && QFile::exists(path))
+    {
+        QMessageBox::warning(this, "Presets", QString("Cannot read %1.").arg(path));
+        return false;
+    }
+
+    presetsPath = path;
+    return true;
+}
+
+// appends the current crosshair to the presets file and the index,
+// unless a preset that looks the same is already saved
+void MainWindow::savePreset()
+{
+    if (!openPresets(true))
+        return;
+
+    if (!presets.index.within(similar::features(m_config), duplicateDistance).empty())
+    {
+        QMessageBox::information(this, "Save Preset", "A preset that looks the same is already saved.");
+        return;
+    }
+
+    QFile file(presetsPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        QMessageBox::warning(this, "Save Preset", QString("Cannot write %1.").arg(presetsPath));
+        return;
+    }
+
+    const QString code = ccode::generateCode(m_config);
+    QTextStream(&file) << code << "\n";
+    presets.add(code, m_config);
+}
+
+// lists the saved presets closest to the current crosshair below the
+// button, picking one applies it like a pasted code
+void MainWindow::showSimilarPresets()
+{
+    if (!openPresets(false))
+        return;
+
+    // one more, in case the current crosshair is saved itself
+    const std::vector<similar::Match> matches =
+        presets.index.nearest(similar::features(m_config), similarPresets + 1);
+
+    QMenu menu(this);
+    int shown = 0;
+
+    for (const similar::Match &match : matches)
+    {
+        if (match.distance <= duplicateDistance || shown == similarPresets)
+            continue;
+
+        const QString code = presets.codes.at(match.index);
+        QAction *action = menu.addAction(QString("%1   (%2)").arg(code).arg(match.distance, 0, 'f', 2));
+        connect(action, &QAction::triggered, this,
+                [this, code]() { model.change([&](Config &cfg) { ccode::applyCode(code, cfg); }); });
+        ++shown;
+    }
+
+    if (shown == 0)
+        menu.addAction("No other presets saved")->setEnabled(false);
+
+    menu.exec(ui.i_similarPresets->mapToGlobal(QPoint(0, ui.i_similarPresets->height())));
+}
+
+// logic for all the buttons. every change of the crosshair options is one transaction of
+// the model, which renders and saves once through showChanges when it is committed.
 void MainWindow::setupConnections()
 {
+    connect(&model, &ConfigModel::changed, this, &MainWindow::showChanges);
+
     // crosshair code LineEdit change handler
-    connect(ui.i_crosshairCode, &QLineEdit::textEdited, this, [this](QString value) {
-        ccode::applyCode(value, m_config);
-        m_config.clamp();
-
-        m_config.saveConfig();
-        m_config.showConfig(ui);
-        crosshairRenderer.show();
-        render();
-    });
+    connect(ui.i_crosshairCode, &QLineEdit::textEdited, this,
+            [this](QString value) { model.change([&](Config &cfg) { ccode::applyCode(value, cfg); }); });
 
     // settings exit button
     connect(ui.i_exit, &QPushButton::clicked, this, [this]() { this->hide(); });
 
-    // screen cycle button
-    connect(ui.i_cycleScreen, &QPushButton::clicked, &crosshairRenderer, &CrosshairRenderer::cycleScreen);
+    // screen cycle button. the renderer stores the index of the
+    // next screen in the config, so it is saved like any other edit
+    connect(ui.i_cycleScreen, &QPushButton::clicked, this,
+            [this]() { model.change([this](Config &) { crosshairRenderer.cycleScreen(); }); });
 
     // reset config button
-    connect(ui.i_resetConf, &QPushButton::clicked, this, [this]() {
-        m_config.resetConfig();
+    connect(ui.i_resetConf, &QPushButton::clicked, this,
+            [this]() { model.change([](Config &cfg) { cfg.resetConfig(); }); });
 
-        updateUi();
-        m_config.saveConfig();
-        m_config.showConfig(ui);
-        crosshairRenderer.show();
+    // color button
+    connect(ui.i_changeColor, &QPushButton::clicked, this,
+            [this]() { pickColor([this](Config &cfg) -> QColor & { return layerColor(cfg); }, "Select Color"); });
 
-        render();
-        crosshairRenderer.update();
+    // layer selection, the crosshair settings below edit the selected layer
+    connect(ui.i_layer, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        currentLayer = qMax(0, index);
+        showConfig();
     });
 
-    // color button
-    connect(ui.i_changeColor, &QPushButton::clicked, this, [this]() {
-        m_config.color = QColorDialog::getColor(m_config.color, this, "Select Color");
-        updateUi();
-        m_config.saveConfig();
-    });
+    // adds a copy of the selected layer on top and selects it
+    connect(ui.i_addLayer, &QPushButton::clicked, this, [this]() {
+        model.change([this](Config &cfg) {
+            if (cfg.extraLayers.size() >= Config::maxExtraLayers)
+                return;
 
-    // enable checkmark
-    connect(ui.i_enableCrosshair, &QCheckBox::toggled, this, [this](bool value) {
-        m_config.enabled = value;
-        render();
-        m_config.saveConfig();
+            cfg.extraLayers.append(cfg.layer(currentLayer));
+            currentLayer = cfg.extraLayers.size();
+        });
     });
 
-    // crosshair length
-    connect(ui.i_length, &QSlider::valueChanged, this, [this](int value) {
-        m_config.length = value;
-        ui.i_length_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
-    });
+    connect(ui.i_removeLayer, &QPushButton::clicked, this, [this]() {
+        model.change([this](Config &cfg) {
+            if (currentLayer == 0)
+                return;
 
-    // crosshair thickness
-    connect(ui.i_thickness, &QSlider::valueChanged, this, [this](int value) {
-        m_config.thickness = value;
-        ui.i_thickness_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
+            cfg.extraLayers.removeAt(currentLayer - 1);
+            --currentLayer;
+        });
     });
 
-    // crosshair gap
-    connect(ui.i_gap, &QSlider::valueChanged, this, [this](int value) {
-        m_config.gap = value;
-        ui.i_gap_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
+    // adaptive color checkmark and its second color
+    bindCheckBox(ui.i_adaptive, [](Config &cfg, bool value) { cfg.adaptive = value; });
+
+    connect(ui.i_changeAdaptiveColor, &QPushButton::clicked, this, [this]() {
+        pickColor([](Config &cfg) -> QColor & { return cfg.adaptiveColor; }, "Select Second Color");
     });
 
-    // crosshair dot enabled
-    connect(ui.i_dotEnabled, &QCheckBox::toggled, this, [this](bool value) {
-        m_config.dot = value;
-        updateUi();
-        m_config.saveConfig();
+    // the adaptive color sampler picked the other color
+    connect(&contrastSampler, &ContrastSampler::switched, this, &MainWindow::render);
+
+    // enable checkmark
+    bindCheckBox(ui.i_enableCrosshair, [](Config &cfg, bool value) { cfg.enabled = value; });
+
+    // crosshair length, thickness and gap of the selected layer
+    bindSlider(ui.i_length, ui.i_length_2, [this](Config &cfg, int value) {
+        editLayer(cfg, [value](Config::Layer &layer) { layer.length = value; });
     });
 
-    // crosshair dot size
-    connect(ui.i_dotSize, &QSlider::valueChanged, this, [this](int value) {
-        m_config.dotSize = value;
-        ui.i_dotSize_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
+    bindSlider(ui.i_thickness, ui.i_thickness_2, [this](Config &cfg, int value) {
+        editLayer(cfg, [value](Config::Layer &layer) { layer.thickness = value; });
     });
 
-    // crosshair shadow enabled
-    connect(ui.i_shadow, &QCheckBox::toggled, this, [this](bool value) {
-        m_config.shadow = value;
-        updateUi();
-        m_config.saveConfig();
+    bindSlider(ui.i_gap, ui.i_gap_2, [this](Config &cfg, int value) {
+        editLayer(cfg, [value](Config::Layer &layer) { layer.gap = value; });
     });
 
-    // crosshair shadow radius
-    connect(ui.i_shadowradius, &QSlider::valueChanged, this, [this](int value) {
-        m_config.shadowBlurRadius = value;
-        ui.i_shadowradius_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
+    // crosshair dot of the selected layer
+    bindCheckBox(ui.i_dotEnabled, [this](Config &cfg, bool value) {
+        editLayer(cfg, [value](Config::Layer &layer) { layer.dot = value; });
     });
 
-    // crosshair shadow alpha
-    connect(ui.i_shadowalpha, &QSlider::valueChanged, this, [this](int value) {
-        m_config.shadowColor = QColor(0, 0, 0, value);
-        ui.i_shadowalpha_2->setValue(value);
-        updateUi();
-        m_config.saveConfig();
+    bindSlider(ui.i_dotSize, ui.i_dotSize_2, [this](Config &cfg, int value) {
+        editLayer(cfg, [value](Config::Layer &layer) { layer.dotSize = value; });
     });
 
-    // here we connect the QSpinBox widgets to the slider so if the spinbox changes it also applies to the slider
-    connect(ui.i_length_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_length, &QSlider::setValue);
+    // crosshair shadow
+    bindCheckBox(ui.i_shadow, [](Config &cfg, bool value) { cfg.shadow = value; });
 
-    connect(ui.i_thickness_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_thickness, &QSlider::setValue);
+    bindSlider(ui.i_shadowradius, ui.i_shadowradius_2, [](Config &cfg, int value) { cfg.shadowBlurRadius = value; });
 
-    connect(ui.i_gap_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_gap, &QSlider::setValue);
+    bindSlider(ui.i_shadowalpha, ui.i_shadowalpha_2,
+               [](Config &cfg, int value) { cfg.shadowColor = QColor(0, 0, 0, value); });
 
-    connect(ui.i_dotSize_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_dotSize, &QSlider::setValue);
+    // crosshair outline
+    bindCheckBox(ui.i_outline, [](Config &cfg, bool value) { cfg.outline = value; });
+
+    bindSlider(ui.i_outlinewidth, ui.i_outlinewidth_2, [](Config &cfg, int value) { cfg.outlineThickness = value; });
+
+    connect(ui.i_changeOutlineColor, &QPushButton::clicked, this, [this]() {
+        pickColor([](Config &cfg) -> QColor & { return cfg.outlineColor; }, "Select Outline Color");
+    });
 
-    connect(ui.i_shadowradius_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_shadowradius, &QSlider::setValue);
+    // presets
+    connect(ui.i_savePreset, &QPushButton::clicked, this, &MainWindow::savePreset);
 
-    connect(ui.i_shadowalpha_2, QOverload<int>::of(&QSpinBox::valueChanged), ui.i_shadowalpha, &QSlider::setValue);
+    connect(ui.i_similarPresets, &QPushButton::clicked, this, &MainWindow::showSimilarPresets);
 }
@@ -9,11 +9,21 @@
 #pragma once
 
 #include "config.h"
+#include "contrast.h"
+#include "control.h"
 #include "crosshair.h"
+#include "model.h"
 #include "render.h"
+#include "similar.h"
+#include "stats.h"
 #include "ui_preset.h"
+#include "watcher.h"
+#include <QCheckBox>
+#include <QSlider>
+#include <QSpinBox>
 #include <QSystemTrayIcon>
 #include <QWidget>
+#include <functional>
 
 class MainWindow : public QWidget
 {
@@ -34,11 +44,49 @@ class MainWindow : public QWidget
 
     void setupConnections();
 
+    void watchConfig(const QString &path);
+
+    void enableStats(EventStats *stats);
+
+    void enableControl(const control::Block *block);
+
+    ConfigModel &configModel();
+
+    qint64 renderCount() const;
+
+    // the options of the last render, with the adaptive color and the
+    // fields driven through the control block applied
+    const Config &renderedOptions() const;
+
+    // time the last updateUi() spent generating the code and the last
+    // render() spent rendering the crosshair image, in nanoseconds
+    qint64 codeTime() const;
+
+    qint64 renderTime() const;
+
   private:
     Config &m_config;
+    ConfigModel model;
 
     Ui::MainWindow ui;
     CrosshairRenderer crosshairRenderer;
+    Crosshair::Layers layers;
+    quint64 shownSerial = 0;
+    Config renderedConfig;
+    Config renderedOpt;
+    sparse::Image shownImage;
+    qint64 renders = 0;
+    qint64 lastCodeTime = 0;
+    qint64 lastRenderTime = 0;
+    int currentLayer = 0;
+    ContrastSampler contrastSampler;
+
+    // saved presets, loaded from their file on first use
+    similar::Presets presets;
+    QString presetsPath;
+
+    ConfigWatcher *configWatcher = nullptr;
+    ControlReader *controlReader = nullptr;
 
     QSystemTrayIcon *trayIcon;
     QMenu *trayMenu;
@@ -48,6 +96,28 @@ class MainWindow : public QWidget
     QPointF dragPosition;
     bool mouseDown = false;
 
+    void showConfig();
+
+    void editLayer(Config &cfg, const std::function<void(Config::Layer &)> &edit);
+
+    QColor &layerColor(Config &cfg);
+
+    void showCode();
+
+    void showChanges();
+
+    void pickColor(const std::function<QColor &(Config &)> &target, const QString &title);
+
+    void bindSlider(QSlider *slider, QSpinBox *spinBox, const std::function<void(Config &, int)> &set);
+
+    void bindCheckBox(QCheckBox *checkBox, const std::function<void(Config &, bool)> &set);
+
+    bool openPresets(bool create);
+
+    void savePreset();
+
+    void showSimilarPresets();
+
     void closeEvent(QCloseEvent *event) override;
 
     void mousePressEvent(QMouseEvent *event) override;
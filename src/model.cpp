@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "model.h"
+
+#include <QElapsedTimer>
+#include <QSettings>
+
+ConfigModel::ConfigModel(Config &cfg, QObject *parent) : QObject(parent), m_config(cfg), m_saved(cfg)
+{
+}
+
+const Config &ConfigModel::config() const
+{
+    return m_config;
+}
+
+void ConfigModel::setStorage(const QString &path)
+{
+    m_storage = path;
+}
+
+// starts a transaction. nested transactions only count, the snapshot
+// to compare against is taken by the outermost one
+void ConfigModel::begin()
+{
+    if (m_depth++ == 0)
+        m_before = m_config;
+}
+
+Config &ConfigModel::edit()
+{
+    Q_ASSERT(m_depth > 0);
+    return m_config;
+}
+
+// ends a transaction. the outermost commit notifies if the config differs
+// from when the transaction began, and saves if it differs from the last save
+void ConfigModel::commit(Commit mode)
+{
+    Q_ASSERT(m_depth > 0);
+    if (--m_depth > 0)
+        return;
+
+    ++m_commits;
+    m_config.clamp();
+
+    m_notifyTime = 0;
+    m_saveTime = 0;
+    QElapsedTimer timer;
+
+    if (!(m_config == m_before))
+    {
+        ++m_notifications;
+        timer.start();
+        emit changed();
+        m_notifyTime = timer.nsecsElapsed();
+    }
+
+    if (mode == Save && !(m_config == m_saved))
+    {
+        timer.start();
+        save();
+        m_saveTime = timer.nsecsElapsed();
+    }
+}
+
+void ConfigModel::change(const std::function<void(Config &)> &edit, Commit mode)
+{
+    begin();
+    edit(m_config);
+    commit(mode);
+}
+
+// takes over a config that was loaded from a file outside of the settings
+// window (e.g. a reloaded profile). it notifies like a commit, but isn't
+// saved: it counts as saved, so the next edit only saves for its own sake
+void ConfigModel::replace(const Config &next)
+{
+    Q_ASSERT(m_depth == 0);
+
+    begin();
+    m_config = next;
+    commit(Preview);
+
+    m_saved = m_config;
+}
+
+void ConfigModel::save()
+{
+    if (m_storage.isEmpty())
+    {
+        m_config.saveConfig();
+    }
+    else
+    {
+        QSettings settings(m_storage, QSettings::IniFormat);
+        m_config.saveTo(settings);
+    }
+
+    m_saved = m_config;
+    ++m_saves;
+}
+
+qint64 ConfigModel::commits() const
+{
+    return m_commits;
+}
+
+qint64 ConfigModel::notifications() const
+{
+    return m_notifications;
+}
+
+qint64 ConfigModel::saves() const
+{
+    return m_saves;
+}
+
+qint64 ConfigModel::notifyTime() const
+{
+    return m_notifyTime;
+}
+
+qint64 ConfigModel::saveTime() const
+{
+    return m_saveTime;
+}
+
+QString ConfigModel::report() const
+{
+    return QString("settings: %1 commits, %2 change notifications, %3 saves")
+        .arg(m_commits)
+        .arg(m_notifications)
+        .arg(m_saves);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <QObject>
+#include <QString>
+#include <functional>
+
+// observable owner of the config edits of the settings window. edits are
+// made in transactions, which can be nested. only when the outermost one
+// commits the config is clamped, and if it actually changed changed() is
+// emitted once and the config is saved once. observers show the new config
+// with the widget signals blocked, so showing a change never feeds back
+// into another edit
+class ConfigModel : public QObject
+{
+    Q_OBJECT
+
+  public:
+    // what a commit does besides notifying
+    enum Commit
+    {
+        Save,
+
+        // live previews (e.g. while a color dialog is open), the
+        // change is written with the next saving commit
+        Preview
+    };
+
+    ConfigModel(Config &cfg, QObject *parent = nullptr);
+
+    const Config &config() const;
+
+    // saves into the given ini file instead of the normal config
+    void setStorage(const QString &path);
+
+    void begin();
+
+    // the config to change, only valid inside of a transaction
+    Config &edit();
+
+    void commit(Commit mode = Save);
+
+    // a whole transaction around edit
+    void change(const std::function<void(Config &)> &edit, Commit mode = Save);
+
+    // applies a config that is stored somewhere else already
+    void replace(const Config &next);
+
+    qint64 commits() const;
+
+    qint64 notifications() const;
+
+    qint64 saves() const;
+
+    // time the last outermost commit spent in the observers of changed()
+    // and saving, in nanoseconds. 0 if it didn't notify or save
+    qint64 notifyTime() const;
+
+    qint64 saveTime() const;
+
+    QString report() const;
+
+  signals:
+    // emitted once per committed transaction that changed the config
+    void changed();
+
+  private:
+    void save();
+
+    Config &m_config;
+    QString m_storage;
+
+    int m_depth = 0;
+
+    // the config when the outermost transaction began and when it was last saved
+    Config m_before;
+    Config m_saved;
+
+    qint64 m_commits = 0;
+    qint64 m_notifications = 0;
+    qint64 m_saves = 0;
+    qint64 m_notifyTime = 0;
+    qint64 m_saveTime = 0;
+};
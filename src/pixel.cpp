@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "pixel.h"
+
+#include <QColor>
+#include <QAtomicInteger>
+#include <QImage>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+namespace pixel
+{
+
+// pixel buffers handed out by allocate() so far
+static QAtomicInteger<qint64> allocatedBuffers;
+
+// rows of buffers from allocate() start on this boundary
+static constexpr int alignment = 64;
+
+static void freeAligned(void *data)
+{
+    qFreeAligned(data);
+}
+
+// allocates a zeroed image whose rows are aligned for vector loads and
+// stores. the render pipeline allocates its buffers once through this
+// and reuses them, allocations() tells if it had to allocate again
+QImage allocate(const QSize &size, QImage::Format format)
+{
+    const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    const qsizetype stride = (qsizetype(size.width()) * depth / 8 + alignment - 1) / alignment * alignment;
+    const qsizetype bytes = qMax<qsizetype>(stride * size.height(), alignment);
+
+    void *data = qMallocAligned(bytes, alignment);
+    if (!data)
+        return QImage();
+    std::memset(data, 0, bytes);
+
+    allocatedBuffers.fetchAndAddRelaxed(1);
+    return QImage(static_cast<uchar *>(data), size.width(), size.height(), stride, format, freeAligned, data);
+}
+
+qint64 allocations()
+{
+    return allocatedBuffers.loadRelaxed();
+}
+
+// fixed point precisions of the exponential blur, the same
+// ones Qt's qt_blurImage uses
+static constexpr int aprec = 12;
+static constexpr int zprec = 10;
+
+// blurs an 8 bit coverage mask (Format_Alpha8) in place. this is a recursive
+// exponential filter (forward + backward pass per axis), so its cost does not
+// grow with the radius. it is close to the blur of QGraphicsDropShadowEffect,
+// not the same: qt_blurImage blurs a half scaled image with half the radius
+// for radii of 4 and up and seeds its accumulators differently, so the two
+// shadows differ at the soft edges. --check-render allows 1% of the pixels
+// to be off by more than 16 of 255 (see diag.cpp). the column pass walks the
+// image row by row and keeps one accumulator per column, which keeps the
+// inner loop free of dependencies so the compiler can vectorize it. only the
+// pixels inside rect are touched, the filter treats everything around it as
+// empty
+void blur(QImage &mask, const QRect &rect, qreal radius)
+{
+    const QRect r = rect.intersected(mask.rect());
+    const int w = r.width();
+    const int h = r.height();
+    if (w <= 0 || h <= 0)
+        return;
+
+    // choose alpha so that a fully covered pixel falls off to about
+    // 2/255 at the given radius
+    const int alpha =
+        radius <= qreal(1e-5) ? (1 << aprec) - 1 : qRound((1 << aprec) * (1 - qPow(2 / qreal(255), 1 / radius)));
+
+    // horizontal pass
+    for (int y = 0; y < h; ++y)
+    {
+        uchar *line = mask.scanLine(r.top() + y) + r.left();
+
+        int z = 0;
+        for (int x = 0; x < w; ++x)
+        {
+            z += alpha * ((int(line[x]) << zprec) - (z >> aprec));
+            line[x] = uchar(z >> (zprec + aprec));
+        }
+        for (int x = w - 2; x >= 0; --x)
+        {
+            z += alpha * ((int(line[x]) << zprec) - (z >> aprec));
+            line[x] = uchar(z >> (zprec + aprec));
+        }
+    }
+
+    // vertical pass, one accumulator per column
+    QVarLengthArray<int, 512> z(w);
+    std::fill(z.begin(), z.end(), 0);
+
+    auto column = [&](int y) {
+        uchar *line = mask.scanLine(r.top() + y) + r.left();
+        for (int x = 0; x < w; ++x)
+        {
+            z[x] += alpha * ((int(line[x]) << zprec) - (z[x] >> aprec));
+            line[x] = uchar(z[x] >> (zprec + aprec));
+        }
+    };
+
+    for (int y = 0; y < h; ++y)
+        column(y);
+    for (int y = h - 2; y >= 0; --y)
+        column(y);
+}
+
+// grows an 8 bit coverage mask by radius pixels in every direction (a max
+// filter over a square window) and writes it into out, which has to be
+// an Alpha8 image of the same size. used for hard outlines, only the
+// pixels inside rect are read and written. the filter is separable, first
+// over columns, then in place over rows. both passes take the max of
+// whole shifted rows, so the inner loops are plain byte max operations
+// the compiler vectorizes
+void dilate(const QImage &mask, QImage &out, const QRect &rect, int radius)
+{
+    const QRect r = rect.intersected(mask.rect());
+    const int w = r.width();
+    if (w <= 0 || r.height() <= 0)
+        return;
+
+    QVarLengthArray<uchar, 1024> row(w);
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+        uchar *dst = out.scanLine(y) + r.left();
+
+        // vertical pass, max over the rows around y
+        const int y0 = qMax(r.top(), y - radius);
+        const int y1 = qMin(r.bottom(), y + radius);
+
+        const uchar *first = mask.constScanLine(y0) + r.left();
+        std::copy(first, first + w, dst);
+
+        for (int yy = y0 + 1; yy <= y1; ++yy)
+        {
+            const uchar *src = mask.constScanLine(yy) + r.left();
+            for (int x = 0; x < w; ++x)
+                dst[x] = qMax(dst[x], src[x]);
+        }
+
+        // horizontal pass on a copy of the row
+        std::copy(dst, dst + w, row.begin());
+        const uchar *src = row.constData();
+
+        for (int k = 1; k <= radius; ++k)
+        {
+            for (int x = 0; x < w - k; ++x)
+                dst[x] = qMax(dst[x], src[x + k]);
+            for (int x = k; x < w; ++x)
+                dst[x] = qMax(dst[x], src[x - k]);
+        }
+    }
+}
+
+// sets all pixels of an 8 bit mask inside rect (clipped to the mask) to
+// value. every row is one contiguous span, so this is a plain memset
+void fill(QImage &mask, const QRect &rect, uchar value)
+{
+    const QRect r = rect.intersected(mask.rect());
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+        std::memset(mask.scanLine(y) + r.left(), value, r.width());
+}
+
+// unites rect of the 8 bit coverage mask src, placed at offset, with
+// mask by taking the max of both per pixel
+void merge(QImage &mask, const QImage &src, const QRect &rect, const QPoint &offset)
+{
+    const QPoint shift = offset - rect.topLeft();
+    const QRect r = rect.intersected(src.rect()).translated(shift).intersected(mask.rect());
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+        uchar *dst = mask.scanLine(y);
+        const uchar *line = src.constScanLine(y - shift.y()) - shift.x();
+
+        for (int x = r.left(); x <= r.right(); ++x)
+            dst[x] = qMax(dst[x], line[x]);
+    }
+}
+
+// sets all pixels of an image inside rect (clipped to the image) to zero
+void clear(QImage &image, const QRect &rect)
+{
+    const QRect r = rect.intersected(image.rect());
+    const int bytes = image.depth() / 8;
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+        std::memset(image.scanLine(y) + r.left() * bytes, 0, r.width() * bytes);
+}
+
+// builds the final premultiplied ARGB32 image from the cached 8 bit masks,
+// this is the only place the crosshair gets expanded to 32 bit pixels.
+// the tints are drawn bottom to top (e.g. shadow, outline, crosshair), each
+// one as its color times its mask coverage. the masks have the size of out
+// and only the pixels inside rect are written. this is the only pass that
+// has to run again when just a color or an alpha changes
+void composite(QImage &out, const QRect &rect, const Tint *tints, int count)
+{
+    const QRect r = rect.intersected(out.rect());
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+        quint32 *dst = reinterpret_cast<quint32 *>(out.scanLine(y));
+        std::fill(dst + r.left(), dst + r.left() + r.width(), 0u);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const Tint &tint = tints[i];
+
+            const quint32 ca = tint.color.alpha();
+            const quint32 cr = tint.color.red();
+            const quint32 cg = tint.color.green();
+            const quint32 cb = tint.color.blue();
+
+            const uchar *src = tint.mask->constScanLine(y);
+
+            // source over, premultiplied
+            for (int x = r.left(); x <= r.right(); ++x)
+            {
+                const quint32 a = div255(src[x] * ca);
+                const quint32 inv = 255 - a;
+                const quint32 d = dst[x];
+
+                const quint32 oa = a + div255((d >> 24) * inv);
+                const quint32 orr = div255(cr * a) + div255(((d >> 16) & 0xff) * inv);
+                const quint32 og = div255(cg * a) + div255(((d >> 8) & 0xff) * inv);
+                const quint32 ob = div255(cb * a) + div255((d & 0xff) * inv);
+
+                dst[x] = (oa << 24) | (orr << 16) | (og << 8) | ob;
+            }
+        }
+    }
+}
+
+// bounding rect of all non transparent pixels of a premultiplied ARGB32
+// image, or an empty rect if the image is fully transparent
+QRect opaqueRect(const QImage &image)
+{
+    int left = image.width();
+    int right = -1;
+    int top = -1;
+    int bottom = -1;
+
+    for (int y = 0; y < image.height(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+
+        int x0 = 0;
+        while (x0 < image.width() && line[x0] == 0)
+            ++x0;
+
+        // empty row
+        if (x0 == image.width())
+            continue;
+
+        int x1 = image.width() - 1;
+        while (line[x1] == 0)
+            --x1;
+
+        if (top < 0)
+            top = y;
+        bottom = y;
+        left = qMin(left, x0);
+        right = qMax(right, x1);
+    }
+
+    if (top < 0)
+        return QRect();
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+// mean luma of an RGB32 / ARGB32 image. pixels that are not transparent in
+// exclude (premultiplied ARGB32, image starts at excludeOffset inside of it)
+// are left out, so the crosshair itself doesn't count as background.
+// the inner loop is branch free so the compiler can vectorize it.
+// returns -1 if every pixel was excluded
+int luminance(const QImage &image, const QImage *exclude, const QPoint &excludeOffset)
+{
+    quint64 sum = 0;
+    quint64 count = 0;
+
+    for (int y = 0; y < image.height(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+
+        // part of the row that overlaps the exclusion image
+        const int ey = y + excludeOffset.y();
+        const bool excludeRow = exclude && ey >= 0 && ey < exclude->height();
+        const quint32 *ex =
+            excludeRow ? reinterpret_cast<const quint32 *>(exclude->constScanLine(ey)) + excludeOffset.x() : nullptr;
+        const int x0 = excludeRow ? qBound(0, -excludeOffset.x(), image.width()) : image.width();
+        const int x1 = excludeRow ? qBound(0, exclude->width() - excludeOffset.x(), image.width()) : image.width();
+
+        quint32 rowSum = 0;
+        quint32 rowCount = 0;
+
+        for (int x = 0; x < image.width(); ++x)
+        {
+            const quint32 p = line[x];
+            const quint32 keep = (x < x0 || x >= x1) ? 1 : ex[x] == 0;
+
+            rowSum += keep * luma((p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff);
+            rowCount += keep;
+        }
+
+        sum += rowSum;
+        count += rowCount;
+    }
+
+    return count ? int(sum / count) : -1;
+}
+
+} // namespace pixel
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include <QColor>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+
+namespace pixel
+{
+
+// an 8 bit coverage mask drawn in a flat color
+struct Tint
+{
+    const QImage *mask;
+    QColor color;
+};
+
+QImage allocate(const QSize &size, QImage::Format format);
+
+qint64 allocations();
+
+void blur(QImage &mask, const QRect &rect, qreal radius);
+
+void dilate(const QImage &mask, QImage &out, const QRect &rect, int radius);
+
+void fill(QImage &mask, const QRect &rect, uchar value);
+
+void merge(QImage &mask, const QImage &src, const QRect &rect, const QPoint &offset);
+
+void clear(QImage &image, const QRect &rect);
+
+void composite(QImage &out, const QRect &rect, const Tint *tints, int count);
+
+QRect opaqueRect(const QImage &image);
+
+int luminance(const QImage &image, const QImage *exclude, const QPoint &excludeOffset);
+
+// fast and exact x / 255 for x in [0, 255 * 255]
+inline quint32 div255(quint32 x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+// Rec. 709 luma of a color in 0..255, in 8 bit fixed point
+inline int luma(int r, int g, int b)
+{
+    return (54 * r + 183 * g + 19 * b) >> 8;
+}
+
+} // namespace pixel
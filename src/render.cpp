@@ -8,12 +8,14 @@
 
 #include "render.h"
 
+#include <QBackingStore>
 #include <QGuiApplication>
-#include <QLabel>
 #include <QList>
+#include <QPainter>
 #include <QPolygon>
 #include <QScreen>
 #include <QWidget>
+#include <algorithm>
 
 // this constructor creates the widget where the crosshair is rendered on screen.
 // its initially centered on the first system screen. it pulls the m_opt ref
@@ -29,11 +31,6 @@ CrosshairRenderer::CrosshairRenderer(Config &opt) : QWidget(), m_opt(opt)
 
     setFixedSize(200, 200);
 
-    // the QPixmap is rendered in this QLabel
-    label = new QLabel(this);
-    label->setGeometry(0, 0, width(), height());
-    label->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-
     QList<QScreen *> screens = QGuiApplication::screens();
 
     // this part of code gets the prefered screen from settings and centeres
@@ -63,7 +60,8 @@ void CrosshairRenderer::cycleScreen()
     if (screens.isEmpty())
         return;
 
-    m_opt.currentScreenIndex = (m_opt.currentScreenIndex + 1) % screens.size();
+    const int current = std::clamp(m_opt.currentScreenIndex, 0, int(screens.size()) - 1);
+    m_opt.currentScreenIndex = (current + 1) % screens.size();
 
     QRect screenGeometry = screens[m_opt.currentScreenIndex]->geometry();
     int cx = screenGeometry.x() + (screenGeometry.width() - width()) / 2;
@@ -80,9 +78,60 @@ void CrosshairRenderer::update()
     if (screens.isEmpty())
         return;
 
-    QRect screenGeometry = screens[m_opt.currentScreenIndex]->geometry();
+    // a reloaded profile can name a screen that isn't connected (anymore),
+    // the crosshair stays on the last one then
+    const int index = std::clamp(m_opt.currentScreenIndex, 0, int(screens.size()) - 1);
+
+    QRect screenGeometry = screens[index]->geometry();
     int cx = screenGeometry.x() + (screenGeometry.width() - width()) / 2;
     int cy = screenGeometry.y() + (screenGeometry.height() - height()) / 2;
 
     move(cx, cy);
-}
\ No newline at end of file
+}
+
+// shows the crosshair image. the image isn't copied, it has to stay
+// alive and is painted from where it is on every repaint. call this
+// again after the image changed
+void CrosshairRenderer::setImage(const sparse::Image *image)
+{
+    m_image = image;
+    m_expanded = QImage();
+    QWidget::update();
+}
+
+// paints the crosshair image centered on the widget. on a raster backing
+// store in the format of the image the runs are blended straight into it,
+// so only the pixels of the crosshair are touched (the window is translucent,
+// its backing store was cleared before this). anything else gets the
+// expanded image drawn with QPainter
+void CrosshairRenderer::paintEvent(QPaintEvent *event)
+{
+    if (!m_image || m_image->isEmpty())
+        return;
+
+    const qreal dpr = m_image->devicePixelRatio;
+    const QSizeF size = QSizeF(m_image->size) / dpr;
+    const QPointF pos((width() - size.width()) / 2.0, (height() - size.height()) / 2.0);
+
+    QBackingStore *store = backingStore();
+    QPaintDevice *device = store ? store->paintDevice() : nullptr;
+
+    if (device && device->devType() == QInternal::Image)
+    {
+        QImage *target = static_cast<QImage *>(device);
+
+        if (target->format() == QImage::Format_ARGB32_Premultiplied && target->devicePixelRatio() == dpr)
+        {
+            const QRect clip = QRectF(QPointF(event->rect().topLeft()) * dpr, QSizeF(event->rect().size()) * dpr)
+                                   .toAlignedRect();
+            sparse::blit(*m_image, *target, (pos * dpr).toPoint(), clip);
+            return;
+        }
+    }
+
+    if (m_expanded.isNull())
+        m_expanded = sparse::expand(*m_image);
+
+    QPainter painter(this);
+    painter.drawImage(pos + QPointF(m_image->rect().topLeft()) / dpr, m_expanded, m_image->rect());
+}
@@ -10,7 +10,9 @@
 
 #include "config.h"
 #include "crosshair.h"
-#include <QLabel>
+#include "sparse.h"
+#include <QImage>
+#include <QPaintEvent>
 #include <QWidget>
 
 class CrosshairRenderer : public QWidget
@@ -22,10 +24,20 @@ class CrosshairRenderer : public QWidget
 
     void update();
 
-    QLabel *label;
+    void setImage(const sparse::Image *image);
+
   public slots:
     void cycleScreen();
 
+  protected:
+    void paintEvent(QPaintEvent *event) override;
+
   private:
     Config &m_opt;
+
+    // owned by the caller, painted straight from there
+    const sparse::Image *m_image = nullptr;
+
+    // dense copy for backing stores the runs can't be blended into
+    QImage m_expanded;
 };
\ No newline at end of file
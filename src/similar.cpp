@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "similar.h"
+
+#include "ccode.h"
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace similar
+{
+
+// sRGB channel in 0..255 to linear light
+static float linear(int c)
+{
+    const float v = c / 255.0f;
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+// the color in OKLab, where distances match perceived color differences.
+// L is in 0..1, a and b roughly in -0.4..0.4
+static void oklab(const QColor &color, float *lab)
+{
+    const float r = linear(color.red());
+    const float g = linear(color.green());
+    const float b = linear(color.blue());
+
+    const float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    const float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    const float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+    lab[0] = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+    lab[1] = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+    lab[2] = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+}
+
+// on/off options weigh half of the whole range of a size, so toggling
+// the dot is about as different as doubling a mid sized arm
+Point features(const Config &opt)
+{
+    Point p;
+    oklab(opt.color, p.data());
+
+    p[3] = opt.length / 50.0f;
+    p[4] = opt.gap / 50.0f;
+    p[5] = opt.thickness / 50.0f;
+    p[6] = opt.dot ? 0.5f : 0.0f;
+    p[7] = opt.dot ? opt.dotSize / 100.0f : 0.0f;
+    p[8] = opt.shadow ? 0.5f : 0.0f;
+    p[9] = opt.shadow ? opt.shadowBlurRadius / 24.0f * opt.shadowColor.alphaF() : 0.0f;
+
+    return p;
+}
+
+static float distance2(const Point &a, const Point &b)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < dimensions; ++i)
+    {
+        const float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+static bool closer(const Match &a, const Match &b)
+{
+    return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+}
+
+// replaces the index with a balanced tree of points. every node splits
+// its subtree at the median of the axis the points spread most along
+void Index::build(std::vector<Point> points)
+{
+    m_points = std::move(points);
+    m_nodes.assign(m_points.size(), Node());
+
+    std::vector<int> order(m_points.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    m_root = buildNode(order.data(), order.data() + order.size());
+}
+
+int Index::buildNode(int *begin, int *end)
+{
+    if (begin == end)
+        return -1;
+
+    Point low = m_points[*begin];
+    Point high = low;
+    for (const int *it = begin; it != end; ++it)
+        for (int i = 0; i < dimensions; ++i)
+        {
+            low[i] = std::min(low[i], m_points[*it][i]);
+            high[i] = std::max(high[i], m_points[*it][i]);
+        }
+
+    int axis = 0;
+    for (int i = 1; i < dimensions; ++i)
+        if (high[i] - low[i] > high[axis] - low[axis])
+            axis = i;
+
+    int *mid = begin + (end - begin) / 2;
+    std::nth_element(begin, mid, end, [this, axis](int a, int b) { return m_points[a][axis] < m_points[b][axis]; });
+
+    Node &node = m_nodes[*mid];
+    node.axis = axis;
+    const int left = buildNode(begin, mid);
+    const int right = buildNode(mid + 1, end);
+
+    // m_nodes isn't resized while building, the reference stays valid
+    node.left = left;
+    node.right = right;
+    return *mid;
+}
+
+// adds a point below the leaf it falls into and returns its index. the
+// tree stays reasonably balanced as long as points don't come in sorted
+int Index::insert(const Point &point)
+{
+    const int index = int(m_points.size());
+    m_points.push_back(point);
+    m_nodes.push_back(Node());
+
+    if (m_root < 0)
+    {
+        m_root = index;
+        return index;
+    }
+
+    int node = m_root;
+    while (true)
+    {
+        Node &n = m_nodes[node];
+        int &child = point[n.axis] < m_points[node][n.axis] ? n.left : n.right;
+
+        if (child < 0)
+        {
+            child = index;
+            m_nodes[index].axis = (n.axis + 1) % dimensions;
+            return index;
+        }
+
+        node = child;
+    }
+}
+
+void Index::clear()
+{
+    m_points.clear();
+    m_nodes.clear();
+    m_root = -1;
+}
+
+int Index::size() const
+{
+    return int(m_points.size());
+}
+
+const Point &Index::point(int index) const
+{
+    return m_points[index];
+}
+
+std::vector<Match> Index::nearest(const Point &query, int k) const
+{
+    std::vector<Match> heap;
+    if (k <= 0)
+        return heap;
+
+    heap.reserve(k + 1);
+    searchNearest(m_root, query, k, heap);
+
+    std::sort_heap(heap.begin(), heap.end(), closer);
+    for (Match &match : heap)
+        match.distance = std::sqrt(match.distance);
+
+    return heap;
+}
+
+// heap is a max heap of squared distances, the farthest of the k best on top
+void Index::searchNearest(int node, const Point &query, int k, std::vector<Match> &heap) const
+{
+    if (node < 0)
+        return;
+
+    const Node &n = m_nodes[node];
+    const Point &p = m_points[node];
+
+    const Match match = {node, distance2(query, p)};
+    if (int(heap.size()) < k || closer(match, heap.front()))
+    {
+        heap.push_back(match);
+        std::push_heap(heap.begin(), heap.end(), closer);
+
+        if (int(heap.size()) > k)
+        {
+            std::pop_heap(heap.begin(), heap.end(), closer);
+            heap.pop_back();
+        }
+    }
+
+    // the side of the query first, the other one only if it can hold a closer point
+    const float split = query[n.axis] - p[n.axis];
+    searchNearest(split < 0 ? n.left : n.right, query, k, heap);
+
+    if (int(heap.size()) < k || split * split <= heap.front().distance)
+        searchNearest(split < 0 ? n.right : n.left, query, k, heap);
+}
+
+std::vector<Match> Index::within(const Point &query, float radius) const
+{
+    std::vector<Match> out;
+    searchWithin(m_root, query, radius * radius, out);
+
+    std::sort(out.begin(), out.end(), closer);
+    for (Match &match : out)
+        match.distance = std::sqrt(match.distance);
+
+    return out;
+}
+
+void Index::searchWithin(int node, const Point &query, float radius2, std::vector<Match> &out) const
+{
+    if (node < 0)
+        return;
+
+    const Node &n = m_nodes[node];
+    const Point &p = m_points[node];
+
+    const float d = distance2(query, p);
+    if (d <= radius2)
+        out.push_back({node, d});
+
+    const float split = query[n.axis] - p[n.axis];
+    if (split < 0 || split * split <= radius2)
+        searchWithin(n.left, query, radius2, out);
+    if (split >= 0 || split * split <= radius2)
+        searchWithin(n.right, query, radius2, out);
+}
+
+// reads a presets file, one crosshair code per line like --export reads
+// them (empty lines and # comments are skipped, invalid codes too), and
+// builds a balanced index of them
+bool Presets::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    codes.clear();
+    std::vector<Point> points;
+
+    QTextStream in(&file);
+    QString line;
+
+    while (in.readLineInto(&line))
+    {
+        const QString code = line.trimmed();
+        if (code.isEmpty() || code.startsWith('#'))
+            continue;
+
+        Config opt;
+        if (!ccode::applyCode(code, opt))
+            continue;
+        opt.clamp();
+
+        codes.append(code);
+        points.push_back(features(opt));
+    }
+
+    index.build(std::move(points));
+    return true;
+}
+
+// adds a single preset to the index, returns its index
+int Presets::add(const QString &code, const Config &opt)
+{
+    codes.append(code);
+    return index.insert(features(opt));
+}
+
+} // namespace similar
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <vector>
+
+namespace similar
+{
+
+// a crosshair as a point in a space where the euclidean distance is how
+// different two crosshairs look: the color in OKLab and the sizes and
+// effects normalized to about 0..1
+static constexpr int dimensions = 10;
+using Point = std::array<float, dimensions>;
+
+Point features(const Config &opt);
+
+struct Match
+{
+    int index;
+    float distance;
+};
+
+// k-d tree over feature points. build() makes a balanced tree of many
+// points at once, insert() adds single points below the existing ones.
+// points are identified by the order they were added in
+class Index
+{
+  public:
+    void build(std::vector<Point> points);
+
+    int insert(const Point &point);
+
+    void clear();
+
+    int size() const;
+
+    const Point &point(int index) const;
+
+    // the k points closest to query, closest first
+    std::vector<Match> nearest(const Point &query, int k) const;
+
+    // all points at most radius away from query, closest first
+    std::vector<Match> within(const Point &query, float radius) const;
+
+  private:
+    struct Node
+    {
+        int left = -1;
+        int right = -1;
+        int axis = 0;
+    };
+
+    int buildNode(int *begin, int *end);
+
+    void searchNearest(int node, const Point &query, int k, std::vector<Match> &heap) const;
+
+    void searchWithin(int node, const Point &query, float radius2, std::vector<Match> &out) const;
+
+    // node i splits at point i
+    std::vector<Point> m_points;
+    std::vector<Node> m_nodes;
+    int m_root = -1;
+};
+
+// crosshair codes, searchable by how their crosshairs look
+struct Presets
+{
+    QStringList codes;
+    Index index;
+
+    bool load(const QString &path);
+
+    int add(const QString &code, const Config &opt);
+};
+
+} // namespace similar
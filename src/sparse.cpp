@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "sparse.h"
+
+#include "pixel.h"
+#include <QDataStream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace sparse
+{
+
+// header of a snapshot written by write()
+static constexpr quint32 magic = 0x50534843; // "CHSP"
+static constexpr quint16 version = 1;
+
+// pixel ratios a snapshot may have, the overlay divides by it and
+// scales its geometry with it
+static constexpr double maxDevicePixelRatio = 16.0;
+
+QRect Image::rect() const
+{
+    return QRect(left, top, width, height);
+}
+
+bool Image::isEmpty() const
+{
+    return runs.empty();
+}
+
+qint64 Image::bytes() const
+{
+    return qint64(rows.size()) * sizeof(quint32) + qint64(runs.size()) * sizeof(Run) +
+           qint64(pixels.size()) * sizeof(QRgb);
+}
+
+// encodes the non transparent pixels of image inside of rect into out. the
+// image has to be premultiplied ARGB32, like everything the renderer makes.
+// rect is just a hint where to look, the box of out is always tight
+void encode(const QImage &image, const QRect &rect, Image &out)
+{
+    out.size = image.size();
+    out.devicePixelRatio = image.devicePixelRatio();
+    out.rows.clear();
+    out.runs.clear();
+    out.pixels.clear();
+
+    const QRect r = rect.intersected(image.rect());
+
+    int top = -1;
+    int bottom = -1;
+    int left = INT_MAX;
+    int right = -1;
+
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+        const quint32 *line = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+        const quint32 first = quint32(out.runs.size());
+
+        int x = r.left();
+        while (x <= r.right())
+        {
+            if (line[x] == 0)
+            {
+                ++x;
+                continue;
+            }
+
+            const int start = x;
+            while (x <= r.right() && line[x] != 0)
+                ++x;
+
+            out.runs.push_back({quint16(start), quint16(x - start)});
+            out.pixels.insert(out.pixels.end(), line + start, line + x);
+        }
+
+        if (out.runs.size() > first)
+        {
+            if (top < 0)
+                top = y;
+            bottom = y;
+            left = qMin(left, int(out.runs[first].x));
+            right = qMax(right, out.runs.back().x + out.runs.back().length - 1);
+        }
+
+        // rows above the first run are left out
+        if (top >= 0)
+            out.rows.push_back(first);
+    }
+
+    if (top < 0)
+    {
+        out.left = 0;
+        out.top = 0;
+        out.width = 0;
+        out.height = 0;
+        return;
+    }
+
+    // and so are the rows below the last one
+    out.rows.resize(bottom - top + 1);
+    out.rows.push_back(quint32(out.runs.size()));
+
+    out.left = qint16(left);
+    out.top = qint16(top);
+    out.width = quint16(right - left + 1);
+    out.height = quint16(bottom - top + 1);
+}
+
+Image encode(const QImage &image)
+{
+    Image out;
+    encode(image, image.rect(), out);
+    return out;
+}
+
+// the dense image again, bit identical to the encoded one
+QImage expand(const Image &image)
+{
+    QImage out(image.size, QImage::Format_ARGB32_Premultiplied);
+    out.fill(Qt::transparent);
+    out.setDevicePixelRatio(image.devicePixelRatio);
+
+    const QRgb *pixels = image.pixels.data();
+
+    for (int row = 0; row < image.height; ++row)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(out.scanLine(image.top + row));
+
+        for (quint32 i = image.rows[row]; i < image.rows[row + 1]; ++i)
+        {
+            const Run &run = image.runs[i];
+            std::memcpy(line + run.x, pixels, run.length * sizeof(QRgb));
+            pixels += run.length;
+        }
+    }
+
+    return out;
+}
+
+// source over of premultiplied pixels
+static inline quint32 over(quint32 s, quint32 d)
+{
+    const quint32 inv = 255 - (s >> 24);
+    if (inv == 0 || d == 0)
+        return s;
+
+    return s + ((pixel::div255((d >> 24) * inv) << 24) | (pixel::div255(((d >> 16) & 0xff) * inv) << 16) |
+                (pixel::div255(((d >> 8) & 0xff) * inv) << 8) | pixel::div255((d & 0xff) * inv));
+}
+
+// draws the image over a premultiplied ARGB32 target, with its top left
+// corner at offset. only the pixels of the runs inside of clip are touched
+void blit(const Image &image, QImage &target, const QPoint &offset, const QRect &clip)
+{
+    const QRect c = clip.intersected(target.rect());
+    if (c.isEmpty())
+        return;
+
+    const QRgb *pixels = image.pixels.data();
+
+    for (int row = 0; row < image.height; ++row)
+    {
+        const int y = image.top + row + offset.y();
+        const quint32 first = image.rows[row];
+        const quint32 end = image.rows[row + 1];
+
+        if (y < c.top() || y > c.bottom())
+        {
+            for (quint32 i = first; i < end; ++i)
+                pixels += image.runs[i].length;
+            continue;
+        }
+
+        quint32 *line = reinterpret_cast<quint32 *>(target.scanLine(y));
+
+        for (quint32 i = first; i < end; ++i)
+        {
+            const Run &run = image.runs[i];
+            const int x0 = qMax(run.x + offset.x(), c.left());
+            const int x1 = qMin(run.x + run.length - 1 + offset.x(), c.right());
+            const QRgb *src = pixels + (x0 - run.x - offset.x());
+
+            for (int x = x0; x <= x1; ++x)
+                line[x] = over(src[x - x0], line[x]);
+
+            pixels += run.length;
+        }
+    }
+}
+
+// writes a snapshot of the image. the format is little endian:
+// header, the run count of every row of the box, the runs and the pixels
+bool write(const Image &image, QIODevice &device)
+{
+    QDataStream stream(&device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    stream << magic << version;
+    stream << quint16(image.size.width()) << quint16(image.size.height()) << double(image.devicePixelRatio);
+    stream << image.left << image.top << image.width << image.height;
+    stream << quint32(image.runs.size());
+
+    for (int row = 0; row < image.height; ++row)
+        stream << quint16(image.rows[row + 1] - image.rows[row]);
+
+    for (const Run &run : image.runs)
+        stream << run.x << run.length;
+
+    for (QRgb p : image.pixels)
+        stream << quint32(p);
+
+    return stream.status() == QDataStream::Ok;
+}
+
+// reads a snapshot written by write(). returns false and leaves
+// image in an unspecified state if it is broken or has a pixel ratio
+// that isn't positive and finite. nothing is allocated
+// for more runs or pixels than the device still holds, so a broken or
+// crafted header can't make it reserve gigabytes
+bool read(QIODevice &device, Image &image)
+{
+    QDataStream stream(&device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    quint32 fileMagic = 0;
+    quint16 fileVersion = 0;
+    stream >> fileMagic >> fileVersion;
+    if (fileMagic != magic || fileVersion != version)
+        return false;
+
+    quint16 w = 0;
+    quint16 h = 0;
+    double dpr = 1.0;
+    quint32 runCount = 0;
+    stream >> w >> h >> dpr;
+    stream >> image.left >> image.top >> image.width >> image.height;
+    stream >> runCount;
+
+    if (stream.status() != QDataStream::Ok || image.left < 0 || image.top < 0 ||
+        image.left + image.width > w || image.top + image.height > h)
+        return false;
+
+    // also false for NaN
+    if (!(dpr > 0 && dpr <= maxDevicePixelRatio))
+        return false;
+
+    // runs are separated by at least one transparent pixel, and after the
+    // row counts every run takes 4 bytes of the device
+    const qint64 maxRuns = qint64(image.height) * ((image.width + 1) / 2);
+    const qint64 runBytes = qint64(runCount) * 4 + qint64(image.height) * 2;
+    if (runCount > maxRuns || runBytes > device.bytesAvailable())
+        return false;
+
+    image.size = QSize(w, h);
+    image.devicePixelRatio = dpr;
+    image.rows.assign(1, 0);
+    image.runs.resize(runCount);
+
+    for (int row = 0; row < image.height; ++row)
+    {
+        quint16 count = 0;
+        stream >> count;
+        image.rows.push_back(image.rows.back() + count);
+    }
+
+    if (image.rows.back() != runCount)
+        return false;
+
+    // runs have to stay inside of the box
+    qint64 pixelCount = 0;
+    for (Run &run : image.runs)
+    {
+        stream >> run.x >> run.length;
+        if (run.x < image.left || run.x + run.length > image.left + image.width)
+            return false;
+        pixelCount += run.length;
+    }
+
+    if (stream.status() != QDataStream::Ok || pixelCount * 4 > device.bytesAvailable())
+        return false;
+
+    image.pixels.resize(pixelCount);
+    for (QRgb &p : image.pixels)
+    {
+        quint32 value = 0;
+        stream >> value;
+        p = value;
+    }
+
+    if (image.height == 0)
+        image.rows.clear();
+
+    return stream.status() == QDataStream::Ok;
+}
+
+} // namespace sparse
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include <QIODevice>
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QtGlobal>
+#include <vector>
+
+namespace sparse
+{
+
+// a horizontal run of non transparent pixels
+struct Run
+{
+    quint16 x;
+    quint16 length;
+};
+
+// a premultiplied ARGB32 image stored as the runs of non transparent pixels
+// of every row. a crosshair covers only a few percent of its canvas, so this
+// is a fraction of the dense image. the vectors keep their capacity when an
+// image is encoded again, so encoding into the same Image doesn't allocate
+struct Image
+{
+    // size and device pixel ratio of the dense image
+    QSize size;
+    qreal devicePixelRatio = 1.0;
+
+    // bounding box of all runs
+    qint16 left = 0;
+    qint16 top = 0;
+    quint16 width = 0;
+    quint16 height = 0;
+
+    // index of the first run of every row of the box, plus the end
+    std::vector<quint32> rows;
+    std::vector<Run> runs;
+
+    // the pixels of all runs, one after another
+    std::vector<QRgb> pixels;
+
+    QRect rect() const;
+
+    bool isEmpty() const;
+
+    // memory used by the pixels and runs
+    qint64 bytes() const;
+};
+
+void encode(const QImage &image, const QRect &rect, Image &out);
+
+Image encode(const QImage &image);
+
+QImage expand(const Image &image);
+
+void blit(const Image &image, QImage &target, const QPoint &offset, const QRect &clip);
+
+bool write(const Image &image, QIODevice &device);
+
+bool read(QIODevice &device, Image &image);
+
+} // namespace sparse
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "stats.h"
+
+#include "render.h"
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QWidget>
+
+EventStats::EventStats(QObject *parent) : QObject(parent)
+{
+}
+
+// hooks into the gui threads event dispatcher and filters
+// all events of the application. starts counting from zero
+void EventStats::start()
+{
+    if (QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance())
+        connect(dispatcher, &QAbstractEventDispatcher::awake, this, [this]() { ++m_wakeups; });
+
+    qApp->installEventFilter(this);
+    reset();
+}
+
+void EventStats::reset()
+{
+    m_wakeups = 0;
+    m_timerEvents = 0;
+    m_overlayPaints = 0;
+    m_timerSources.clear();
+    m_elapsed.start();
+}
+
+qint64 EventStats::wakeups() const
+{
+    return m_wakeups;
+}
+
+qint64 EventStats::timerEvents() const
+{
+    return m_timerEvents;
+}
+
+qint64 EventStats::overlayPaints() const
+{
+    return m_overlayPaints;
+}
+
+double EventStats::seconds() const
+{
+    return m_elapsed.nsecsElapsed() / 1e9;
+}
+
+// human readable summary of everything counted since the last reset
+QString EventStats::report() const
+{
+    const double s = qMax(seconds(), 1e-9);
+
+    QString text = QString("%1 s: %2 wakeups (%3/s), %4 timer events (%5/s), %6 overlay paints (%7/s)")
+                       .arg(s, 0, 'f', 1)
+                       .arg(m_wakeups)
+                       .arg(m_wakeups / s, 0, 'f', 2)
+                       .arg(m_timerEvents)
+                       .arg(m_timerEvents / s, 0, 'f', 2)
+                       .arg(m_overlayPaints)
+                       .arg(m_overlayPaints / s, 0, 'f', 2);
+
+    for (auto it = m_timerSources.cbegin(); it != m_timerSources.cend(); ++it)
+        text += QString("\n  timer events of %1: %2").arg(QString::fromLatin1(it.key())).arg(it.value());
+
+    return text;
+}
+
+// counts timer events of all objects and paint events of the
+// overlay window and its children. never filters anything out
+bool EventStats::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type())
+    {
+    case QEvent::Timer:
+        ++m_timerEvents;
+        ++m_timerSources[watched->metaObject()->className()];
+        break;
+
+    case QEvent::Paint:
+        if (QWidget *widget = qobject_cast<QWidget *>(watched))
+            if (qobject_cast<CrosshairRenderer *>(widget->window()))
+                ++m_overlayPaints;
+        break;
+
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+// counts event loop activity of the gui thread, to verify that the
+// process stays asleep while nothing changes. install it with start()
+class EventStats : public QObject
+{
+    Q_OBJECT
+
+  public:
+    EventStats(QObject *parent = nullptr);
+
+    void start();
+
+    void reset();
+
+    qint64 wakeups() const;
+
+    qint64 timerEvents() const;
+
+    qint64 overlayPaints() const;
+
+    double seconds() const;
+
+    QString report() const;
+
+  protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+  private:
+    QElapsedTimer m_elapsed;
+
+    qint64 m_wakeups = 0;
+    qint64 m_timerEvents = 0;
+    qint64 m_overlayPaints = 0;
+
+    // timer events per receiving class, to find who keeps waking us up
+    QHash<QByteArray, qint64> m_timerSources;
+};
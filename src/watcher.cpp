@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#include "watcher.h"
+
+#include "config.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+
+// time to wait for more writes before reading the file,
+// tools often write a file in several steps
+static constexpr int debounceInterval = 50;
+
+ConfigWatcher::ConfigWatcher(ConfigModel &model, const QString &path, QObject *parent)
+    : QObject(parent), m_model(model), m_path(QFileInfo(path).absoluteFilePath())
+{
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(debounceInterval);
+
+    connect(&m_debounce, &QTimer::timeout, this, &ConfigWatcher::reload);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ConfigWatcher::scheduleReload);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &ConfigWatcher::scheduleReload);
+
+    watch();
+
+    // apply the profile once on startup
+    m_pending.start();
+    reload();
+}
+
+qint64 ConfigWatcher::lastReloadLatency() const
+{
+    return m_latency;
+}
+
+// many editors replace the file instead of writing to it, which drops it
+// from the watcher. the directory is watched too, to notice it coming back
+void ConfigWatcher::watch()
+{
+    const QString dir = QFileInfo(m_path).absolutePath();
+
+    if (!m_watcher.directories().contains(dir))
+        m_watcher.addPath(dir);
+
+    if (QFileInfo::exists(m_path) && !m_watcher.files().contains(m_path))
+        m_watcher.addPath(m_path);
+}
+
+// restarts the debounce timer on every notification, so a burst of
+// writes results in a single reload. the latency is measured from
+// the first notification of the burst
+void ConfigWatcher::scheduleReload()
+{
+    if (!m_debounce.isActive())
+        m_pending.start();
+
+    m_debounce.start();
+}
+
+// reads the profile and applies it. unchanged files are skipped without
+// parsing. every change is applied, also ones without a visible effect,
+// so they aren't lost to the next save. the model only notifies if the
+// config changed, and the MainWindow only re-renders if it looks different
+void ConfigWatcher::reload()
+{
+    watch();
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    const QByteArray content = file.readAll();
+    file.close();
+
+    if (content == m_lastContent)
+        return;
+    m_lastContent = content;
+
+    QSettings settings(m_path, QSettings::IniFormat);
+
+    Config next = m_model.config();
+    next.loadFrom(settings);
+    next.clamp();
+
+    m_model.replace(next);
+
+    m_latency = m_pending.nsecsElapsed() / 1000;
+    ++m_reloads;
+}
+
+// reload summary for the statistics
+QString ConfigWatcher::report() const
+{
+    if (m_reloads == 0)
+        return QString("profile %1: not applied yet").arg(m_path);
+
+    return QString("profile %1: %2 reloads, last one took %3 ms")
+        .arg(m_path)
+        .arg(m_reloads)
+        .arg(m_latency / 1000.0, 0, 'f', 3);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2025 @Drumba08 <drumba08@gmail.com>
+ *
+ * Licensed under the GNU General Public License v3.0 (GPLv3)
+ * See the LICENSE file for full license text.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "model.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+// watches a profile file (ini with the same keys as the saved config)
+// and applies its options through the model whenever the file is written
+class ConfigWatcher : public QObject
+{
+    Q_OBJECT
+
+  public:
+    ConfigWatcher(ConfigModel &model, const QString &path, QObject *parent = nullptr);
+
+    // time from the first change notification of a burst until the
+    // new config was applied, in microseconds. -1 before the first reload
+    qint64 lastReloadLatency() const;
+
+    QString report() const;
+
+  private:
+    void scheduleReload();
+
+    void reload();
+
+    void watch();
+
+    ConfigModel &m_model;
+    QString m_path;
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    QElapsedTimer m_pending;
+
+    QByteArray m_lastContent;
+    qint64 m_latency = -1;
+    qint64 m_reloads = 0;
+};